@@ -73,6 +73,28 @@ static void tcp_buffer_put_byte(struct tcp_buf *buf, char dat) {
   }
 }
 
+// Copy as many bytes of dat as fit into buf, returns the number copied
+static size_t tcp_buffer_put_bytes(struct tcp_buf *buf, const char *dat,
+                                   size_t len) {
+  size_t num_put = 0;
+  unsigned int wptr = buf->wptr;
+  while (num_put < len && !tcp_buffer_is_full(buf)) {
+    // Fill the contiguous free space up to the end of the buffer, or up to
+    // the byte before rptr, whichever comes first.
+    unsigned int rptr = buf->rptr;
+    unsigned int end = (rptr > wptr) ? rptr - 1 : BUFSIZE_BYTE - (rptr == 0);
+    size_t chunk = end - wptr;
+    if (chunk > len - num_put) {
+      chunk = len - num_put;
+    }
+    memcpy(&buf->buf[wptr], dat + num_put, chunk);
+    num_put += chunk;
+    wptr = (wptr + chunk) % BUFSIZE_BYTE;
+    buf->wptr = wptr;
+  }
+  return num_put;
+}
+
 static bool tcp_buffer_get_byte(struct tcp_buf *buf, char *dat) {
   if (tcp_buffer_is_empty(buf)) {
     return false;
@@ -267,30 +289,36 @@ static bool get_byte(struct tcp_server_ctx *ctx, char *cmd) {
 }
 
 /**
- * Send a byte to a connected client
+ * Send the contents of the output buffer to a connected client
+ *
+ * Sends contiguous blocks of the buffer, and returns without waiting if the
+ * client can't take any more data. If the client went away, the remaining
+ * contents of the buffer are dropped.
  *
  * @param ctx context object
- * @param cmd byte to send
  */
-static void put_byte(struct tcp_server_ctx *ctx, char cmd) {
-  while (1) {
-    ssize_t num_written = send(ctx->cfd, &cmd, sizeof(cmd), MSG_NOSIGNAL);
+static void put_buffered(struct tcp_server_ctx *ctx) {
+  struct tcp_buf *buf = ctx->buf_out;
+  while (!tcp_buffer_is_empty(buf)) {
+    unsigned int rptr = buf->rptr;
+    unsigned int wptr = buf->wptr;
+    size_t chunk = (wptr > rptr) ? wptr - rptr : BUFSIZE_BYTE - rptr;
+    ssize_t num_written = send(ctx->cfd, &buf->buf[rptr], chunk, MSG_NOSIGNAL);
     if (num_written == -1) {
-      if (errno == EAGAIN || errno == EWOULDBLOCK) {
-        continue;
-      } else if (errno == EPIPE) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return;
+      }
+      if (errno == EPIPE || errno == ECONNRESET) {
         printf("%s: Remote disconnected.\n", ctx->display_name);
-        tcp_server_client_close(ctx);
-        break;
       } else {
         fprintf(stderr, "%s: Error while writing to client: %s (%d)\n",
                 ctx->display_name, strerror(errno), errno);
-        assert(0 && "Error writing to client.");
       }
+      tcp_server_client_close(ctx);
+      buf->rptr = buf->wptr;
+      return;
     }
-    if (num_written >= 1) {
-      break;
-    }
+    buf->rptr = (rptr + num_written) % BUFSIZE_BYTE;
   }
 }
 
@@ -378,9 +406,7 @@ static void *server_create(void *ctx_void) {
     }
 
     if (ctx->cfd != 0) {
-      while (tcp_buffer_get_byte(ctx->buf_out, &xfer_data)) {
-        put_byte(ctx, xfer_data);
-      }
+      put_buffered(ctx);
     }
   }
 
@@ -435,6 +461,14 @@ void tcp_server_write(struct tcp_server_ctx *ctx, char dat) {
   tcp_buffer_put_byte(ctx->buf_out, dat);
 }
 
+size_t tcp_server_write_bulk(struct tcp_server_ctx *ctx, const char *dat,
+                             size_t len) {
+  if (ctx->cfd == 0) {
+    return len;
+  }
+  return tcp_buffer_put_bytes(ctx->buf_out, dat, len);
+}
+
 void tcp_server_close(struct tcp_server_ctx *ctx) {
   // Shut down the socket thread
   ctx->socket_run = false;
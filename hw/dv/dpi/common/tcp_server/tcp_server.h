@@ -17,6 +17,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 struct tcp_server_ctx;
@@ -41,6 +42,21 @@ bool tcp_server_read(struct tcp_server_ctx *ctx, char *dat);
  */
 void tcp_server_write(struct tcp_server_ctx *ctx, char dat);
 
+/**
+ * Non-blocking write of a block of bytes to a connected client
+ *
+ * As many bytes as fit are added to the internal buffer. If no client is
+ * connected, all bytes are discarded. Callers which need the whole block to be
+ * sent call this again with the remaining bytes until everything is consumed.
+ *
+ * @param ctx tcp server context object
+ * @param dat bytes to send
+ * @param len number of bytes in dat
+ * @return number of bytes consumed (buffered or discarded)
+ */
+size_t tcp_server_write_bulk(struct tcp_server_ctx *ctx, const char *dat,
+                             size_t len);
+
 /**
  * Create a new TCP server instance
  *
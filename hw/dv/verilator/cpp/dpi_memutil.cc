@@ -4,13 +4,19 @@
 
 #include "dpi_memutil.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
+#include <exception>
 #include <fcntl.h>
 #include <iostream>
 #include <libelf.h>
+#include <list>
+#include <mutex>
 #include <sstream>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
 #include <vector>
 
@@ -46,7 +52,9 @@ class ElfFile {
       throw ElfError(path, "could not open file.");
     }
 
-    ptr_ = elf_begin(fd_, ELF_C_READ, NULL);
+    // Map the file rather than reading it, so that staged segments can point
+    // straight into the file contents.
+    ptr_ = elf_begin(fd_, ELF_C_READ_MMAP, NULL);
     if (!ptr_) {
       close(fd_);
       throw ElfError(path, elf_errmsg(-1));
@@ -64,6 +72,9 @@ class ElfFile {
     close(fd_);
   }
 
+  ElfFile(const ElfFile &) = delete;
+  ElfFile &operator=(const ElfFile &) = delete;
+
   size_t GetPhdrNum() {
     size_t phnum;
     if (elf_getphdrnum(ptr_, &phnum) != 0) {
@@ -92,6 +103,8 @@ static MemImageType GetMemImageTypeByName(const std::string &name) {
     return kMemImageElf;
   if (name == "vmem")
     return kMemImageVmem;
+  if (name == "raw" || name == "bin")
+    return kMemImageRaw;
 
   std::ostringstream oss;
   oss << "Unknown image type: `" << name << "'.";
@@ -121,13 +134,14 @@ static MemImageType DetectMemImageType(const std::string &filepath) {
   return image_type;
 }
 
-// Generate a single array of bytes representing the contents of PT_LOAD
-// segments of the ELF file. Like objcopy, this generates a single "giant
-// segment" whose first byte corresponds to the first byte of the lowest
-// addressed segment and whose last byte corresponds to the last byte of the
-// highest address.
-static std::vector<uint8_t> FlattenElfFile(const std::string &filepath) {
-  ElfFile elf(filepath);
+// Stage the contents of the PT_LOAD segments of the ELF file, relative to
+// the lowest addressed segment. Like objcopy, the flat image of the result
+// is a single "giant segment" whose first byte corresponds to the first byte
+// of the lowest addressed segment and whose last byte corresponds to the last
+// byte of the highest address. The segments are views into the mapped file.
+static StagedMem StageFlatElfFile(const std::string &filepath) {
+  auto elf_ptr = std::make_shared<ElfFile>(filepath);
+  ElfFile &elf = *elf_ptr;
 
   size_t phnum = elf.GetPhdrNum();
   const Elf32_Phdr *phdrs = elf.GetPhdrs();
@@ -175,7 +189,7 @@ static std::vector<uint8_t> FlattenElfFile(const std::string &filepath) {
   // If any is false, there were no segments that contributed to the
   // file. Return nothing.
   if (!any)
-    return std::vector<uint8_t>();
+    return StagedMem();
 
   // Otherwise, we know every valid byte of data has an address in the
   // range [low, high] (inclusive).
@@ -207,21 +221,26 @@ static std::vector<uint8_t> FlattenElfFile(const std::string &filepath) {
       continue;
 
     uint32_t off = phdr.p_paddr - low;
-    std::vector<uint8_t> seg(phdr.p_filesz, 0);
-    memcpy(&seg[0], file_data + phdr.p_offset, phdr.p_filesz);
-    ret.AddSegment(off, std::move(seg));
+    const uint8_t *seg_data =
+        reinterpret_cast<const uint8_t *>(file_data) + phdr.p_offset;
+    ret.AddSegment(off, SegData(elf_ptr, seg_data, phdr.p_filesz));
   }
 
-  return ret.GetFlat();
+  return ret;
+}
+
+SegData::SegData(std::vector<uint8_t> &&data) {
+  auto vec = std::make_shared<std::vector<uint8_t>>(std::move(data));
+  data_ = vec->data();
+  size_ = vec->size();
+  owner_ = std::move(vec);
 }
 
 // Merge seg0 and seg1, overwriting any overlapping data in seg0 with
 // that from seg1. rng0/rng1 is the base and top address of seg0/seg1,
 // respectively.
-static std::vector<uint8_t> MergeSegments(const AddrRange<uint32_t> &rng0,
-                                          std::vector<uint8_t> &&seg0,
-                                          const AddrRange<uint32_t> &rng1,
-                                          std::vector<uint8_t> &&seg1) {
+static SegData MergeSegments(const AddrRange<uint32_t> &rng0, SegData &&seg0,
+                             const AddrRange<uint32_t> &rng1, SegData &&seg1) {
   // First, deal with the special case where seg1 completely contains
   // seg0 (since there's no copying needed at all).
   if (rng1.lo <= rng0.lo && rng0.hi <= rng1.hi) {
@@ -235,49 +254,16 @@ static std::vector<uint8_t> MergeSegments(const AddrRange<uint32_t> &rng0,
   assert(seg0.size() <= new_len);
   assert(seg1.size() <= new_len);
 
-  // We want to avoid copying if possible. The next most efficient
-  // case (after just returning seg1) is when seg0 doesn't stick out
-  // the left hand end. In this case, we can extend seg1 to the right
-  // (which might not cause a copy) and then copy just the bytes we
-  // need from seg0.
-  if (rng1.lo <= rng0.lo) {
-    assert(rng1.hi < rng0.hi);
-    assert(new_len == seg1.size() + (rng0.hi - rng1.hi));
-
-    size_t old_len = seg1.size();
-    std::vector<uint8_t> ret = std::move(seg1);
-    ret.resize(new_len);
-
-    // We know that rng0 isn't completely contained in rng1 and
-    // that rng0 doesn't stick out of the left hand end. That means it
-    // must stick out of the right (so rng1.hi < rng0.hi). However, we
-    // also know that the two ranges overlap, so rng0.lo <= rng1.hi.
-    assert(rng0.lo <= rng1.hi);
-
-    // src_off is the index of the first byte that needs copying from
-    // seg0. Note that this is always at least 1 (because there is an
-    // actual overlap).
-    uint32_t src_off = 1 + (rng1.hi - rng0.lo);
-
-    assert(seg0.size() == src_off + (rng0.hi - rng1.hi));
-
-    memcpy(&ret[old_len], &seg0[src_off], rng0.hi - rng1.hi);
-    return ret;
-  }
-
-  // In this final case, seg0 sticks out the left hand end. That means
-  // we'll have to copy seg1 whatever happens (because we have to
-  // shuffle its elements to the right). Work by resizing seg0 and
-  // then writing seg1 where it's needed.
-  std::vector<uint8_t> ret = std::move(seg0);
-  ret.resize(new_len);
-
-  uint32_t off = rng1.lo - rng0.lo;
-  memcpy(&ret[off], &seg1[0], seg1.size());
-  return ret;
+  // Segments are usually views into a mapped ELF file, which can't be
+  // extended in place. Copy both into a new buffer, seg1 last so that it wins
+  // where they overlap.
+  std::vector<uint8_t> ret(new_len, 0);
+  memcpy(&ret[rng0.lo - new_bot], seg0.data(), seg0.size());
+  memcpy(&ret[rng1.lo - new_bot], seg1.data(), seg1.size());
+  return SegData(std::move(ret));
 }
 
-void StagedMem::AddSegment(uint32_t offset, std::vector<uint8_t> &&seg) {
+void StagedMem::AddSegment(uint32_t offset, SegData &&seg) {
   if (seg.empty())
     return;
 
@@ -298,14 +284,14 @@ std::vector<uint8_t> StagedMem::GetFlat() const {
 
   for (const auto &pr : segs_) {
     const AddrRange<uint32_t> &rng = pr.first;
-    const std::vector<uint8_t> &seg = pr.second;
+    const SegData &seg = pr.second;
     assert(seg.size() == 1 + (rng.hi - rng.lo));
     assert(min_addr_ <= rng.lo);
 
     uint32_t off = rng.lo - min_addr_;
     assert(off + seg.size() <= ret.size());
 
-    memcpy(&ret[off], &seg[0], seg.size());
+    memcpy(&ret[off], seg.data(), seg.size());
   }
   return ret;
 }
@@ -353,6 +339,49 @@ void DpiMemUtil::RegisterMemoryArea(const std::string &name, uint32_t base,
   names_.push_back(name);
 }
 
+void DpiMemUtil::SetImageCacheDir(const std::string &dir) {
+  if (dir.empty()) {
+    image_cache_.reset();
+  } else {
+    image_cache_.reset(new MemImageCache(dir));
+  }
+}
+
+void DpiMemUtil::SetLoadJobs(unsigned jobs) {
+  assert(jobs > 0);
+  load_jobs_ = jobs;
+}
+
+void DpiMemUtil::StartLoadBatch() {
+  in_batch_ = true;
+  pending_writes_.clear();
+}
+
+void DpiMemUtil::FinishLoadBatch() {
+  in_batch_ = false;
+  FlushWrites();
+}
+
+const MemArea *DpiMemUtil::FindMemoryArea(const std::string &name,
+                                          uint32_t *base) const {
+  auto it = name_to_mem_.find(name);
+  if (it == name_to_mem_.end()) {
+    return nullptr;
+  }
+  if (base) {
+    *base = base_addrs_[it->second];
+  }
+  return mem_areas_[it->second];
+}
+
+std::vector<std::string> DpiMemUtil::GetMemoryNames() const {
+  std::vector<std::string> names;
+  for (const auto &pr : name_to_mem_) {
+    names.push_back(pr.first);
+  }
+  return names;
+}
+
 MemImageType DpiMemUtil::GetMemImageType(const std::string &path,
                                          const char *type) {
   return type ? GetMemImageTypeByName(type) : DetectMemImageType(path);
@@ -396,25 +425,79 @@ void DpiMemUtil::LoadFileToNamedMem(bool verbose, const std::string &name,
               << name << "'." << std::endl;
   }
 
-  const MemArea &m = *mem_areas_[it->second];
+  std::string context = "the scope associated with region `" + name + "'";
+  switch (type) {
+    case kMemImageElf:
+      QueueFlat(it->second, StageFlatElfFile(filepath), context);
+      break;
+    case kMemImageRaw: {
+      MemDump raw = ReadMemDump(filepath, kMemImageRaw);
+      if (raw.data.size() > mem_areas_[it->second]->GetSizeBytes()) {
+        std::ostringstream oss;
+        oss << "File `" << filepath << "' has " << raw.data.size()
+            << " bytes, but memory region `" << name << "' only has "
+            << mem_areas_[it->second]->GetSizeBytes() << ".";
+        throw std::runtime_error(oss.str());
+      }
+      QueueWrite(it->second, 0, SegData(std::move(raw.data)), context);
+      break;
+    }
+    case kMemImageVmem:
+      // Vmem files are written to the memory while they are parsed, so
+      // anything queued has to be written first.
+      FlushWrites();
+      try {
+        mem_areas_[it->second]->LoadVmem(filepath);
+      } catch (const SVScoped::Error &err) {
+        std::ostringstream oss;
+        oss << "No memory found at `" << err.scope_name_ << "' (" << context
+            << ").";
+        throw std::runtime_error(oss.str());
+      }
+      break;
+    default:
+      assert(0);
+  }
+
+  if (!in_batch_) {
+    FlushWrites();
+  }
+}
 
+void DpiMemUtil::DumpNamedMem(bool verbose, const std::string &name,
+                              const std::string &filepath,
+                              MemImageType type) const {
+  if (type == kMemImageUnknown) {
+    type = DetectMemImageType(filepath);
+  }
+  assert(type != kMemImageUnknown);
+
+  auto it = name_to_mem_.find(name);
+  if (it == name_to_mem_.end()) {
+    std::ostringstream oss;
+    oss << "`" << name
+        << ("' is not the name of a known memory region. "
+            "Run with --meminit=list to get a list.");
+    throw std::runtime_error(oss.str());
+  }
+
+  if (verbose) {
+    std::cout << "Dumping memory `" << name << "' to file `" << filepath
+              << "'." << std::endl;
+  }
+
+  const MemArea &m = *mem_areas_[it->second];
+  MemDump dump = {base_addrs_[it->second], m.GetWidthByte(), {}};
   try {
-    switch (type) {
-      case kMemImageElf:
-        m.Write(0, FlattenElfFile(filepath));
-        break;
-      case kMemImageVmem:
-        m.LoadVmem(filepath);
-        break;
-      default:
-        assert(0);
-    }
+    dump.data = m.Read(0, m.GetSizeWords());
   } catch (const SVScoped::Error &err) {
     std::ostringstream oss;
     oss << "No memory found at `" << err.scope_name_
         << "' (the scope associated with region `" << name << "').";
     throw std::runtime_error(oss.str());
   }
+
+  WriteMemDump(filepath, type, dump);
 }
 
 void DpiMemUtil::LoadElfToMemories(bool verbose, const std::string &filepath) {
@@ -428,34 +511,34 @@ void DpiMemUtil::LoadElfToMemories(bool verbose, const std::string &filepath) {
     auto mem_area_it = name_to_mem_.find(mem_name);
     assert(mem_area_it != name_to_mem_.end());
 
-    const MemArea &mem_area = *mem_areas_[mem_area_it->second];
+    size_t mem_idx = mem_area_it->second;
+    uint32_t width_byte = mem_areas_[mem_idx]->GetWidthByte();
 
     for (const auto &seg_pr : staged_mem.GetSegs()) {
       const AddrRange<uint32_t> &seg_rng = seg_pr.first;
-      const std::vector<uint8_t> &seg_data = seg_pr.second;
 
-      assert(seg_rng.lo % mem_area.GetWidthByte() == 0);
-      uint32_t lo_word = seg_rng.lo / mem_area.GetWidthByte();
-
-      try {
-        mem_area.Write(lo_word, seg_data);
-      } catch (const SVScoped::Error &err) {
-        std::ostringstream oss;
-        oss << "No memory found at `" << err.scope_name_
-            << "' (the scope associated with region `" << mem_name
-            << "', used by a segment that starts at LMA 0x" << std::hex
-            << base_addrs_[mem_area_it->second] + seg_rng.lo << ").";
-        throw std::runtime_error(oss.str());
-      }
+      assert(seg_rng.lo % width_byte == 0);
+      std::ostringstream context;
+      context << "the scope associated with region `" << mem_name
+              << "', used by a segment that starts at LMA 0x" << std::hex
+              << base_addrs_[mem_idx] + seg_rng.lo;
+      QueueWrite(mem_idx, seg_rng.lo / width_byte, seg_pr.second,
+                 context.str());
     }
   }
+
+  if (!in_batch_) {
+    FlushWrites();
+  }
 }
 
 void DpiMemUtil::StageElf(bool verbose, const std::string &path) {
   // Clear out anything that was in the staging area before
   staging_area_.clear();
 
-  ElfFile elf(path);
+  // The staged segments keep the mapped file alive
+  auto elf_ptr = std::make_shared<ElfFile>(path);
+  ElfFile &elf = *elf_ptr;
 
   // Allow subclasses to get at the loaded ELF data if they need it
   OnElfLoaded(elf.ptr_);
@@ -516,11 +599,10 @@ void DpiMemUtil::StageElf(bool verbose, const std::string &path) {
     // there isn't one, make a new empty one.
     StagedMem &staged_mem = staging_area_[name];
 
-    const char *seg_data = file_data + phdr.p_offset;
-    std::vector<uint8_t> vec(phdr.p_filesz, 0);
-    memcpy(&vec[0], seg_data, phdr.p_filesz);
-
-    staged_mem.AddSegment(local_base, std::move(vec));
+    const uint8_t *seg_data =
+        reinterpret_cast<const uint8_t *>(file_data) + phdr.p_offset;
+    staged_mem.AddSegment(local_base,
+                          SegData(elf_ptr, seg_data, phdr.p_filesz));
   }
 }
 
@@ -571,3 +653,172 @@ size_t DpiMemUtil::GetRegionForSegment(const std::string &path, int seg_idx,
 
   return mem_area_it->second;
 }
+
+void DpiMemUtil::QueueWrite(size_t mem_idx, uint32_t word_offset, SegData data,
+                            const std::string &context) {
+  pending_writes_.push_back(
+      {mem_idx, word_offset, std::move(data), 0, context, "", {}});
+}
+
+void DpiMemUtil::QueueFlat(size_t mem_idx, const StagedMem &staged,
+                           const std::string &context) {
+  const StagedMem::SegMap &segs = staged.GetSegs();
+  if (segs.size() == 0) {
+    return;
+  }
+
+  uint32_t width_byte = mem_areas_[mem_idx]->GetWidthByte();
+  uint32_t min_addr = staged.GetBounds().first;
+
+  // Segments starting in the middle of a word share it with the end of the
+  // previous segment or a gap, so go through the flat array for them.
+  for (const auto &pr : segs) {
+    if ((pr.first.lo - min_addr) % width_byte) {
+      QueueWrite(mem_idx, 0, SegData(staged.GetFlat()), context);
+      return;
+    }
+  }
+
+  uint32_t next_word = 0;
+  for (const auto &pr : segs) {
+    uint32_t word = (pr.first.lo - min_addr) / width_byte;
+    assert(next_word <= word);
+
+    if (next_word < word) {
+      pending_writes_.push_back(
+          {mem_idx, next_word, SegData(), word - next_word, context, "", {}});
+    }
+    QueueWrite(mem_idx, word, pr.second, context);
+    next_word = word + (pr.second.size() + width_byte - 1) / width_byte;
+  }
+}
+
+void DpiMemUtil::FlushWrites() {
+  std::vector<PendingWrite> writes;
+  writes.swap(pending_writes_);
+
+  // With more than one job, the images of memories with an encoding are
+  // computed on worker threads. Reading the encoding parameters and computing
+  // the cache entries needs the simulation, so happens here first.
+  bool encode = load_jobs_ > 1;
+  // The encoding of every memory written is held until all writes are done.
+  // A TransferHold of a memory which is held already does nothing.
+  std::list<TransferHold> holds;
+  std::vector<size_t> to_encode;
+
+  const PendingWrite *current = nullptr;
+  try {
+    if (encode) {
+      for (size_t i = 0; i < writes.size(); ++i) {
+        PendingWrite &write = writes[i];
+        const MemArea &mem_area = *mem_areas_[write.mem_idx];
+        current = &write;
+
+        if (write.data.empty()) {
+          continue;
+        }
+        holds.emplace_back(mem_area);
+        if (mem_area.GetEncodingId().empty()) {
+          continue;
+        }
+        if (image_cache_) {
+          write.cache_entry = image_cache_->GetEntry(
+              mem_area, write.word_offset, write.data.data(),
+              write.data.size());
+        }
+        to_encode.push_back(i);
+      }
+      current = nullptr;
+
+      EncodePendingWrites(writes, to_encode);
+    }
+
+    // The writes into the simulation happen in order, so that later loads
+    // overwrite earlier ones.
+    size_t next_encoded = 0;
+    for (size_t i = 0; i < writes.size(); ++i) {
+      const PendingWrite &write = writes[i];
+      const MemArea &mem_area = *mem_areas_[write.mem_idx];
+      current = &write;
+
+      if (write.data.empty()) {
+        mem_area.Fill(write.word_offset, write.fill_words, 0);
+      } else if (next_encoded < to_encode.size() &&
+                 to_encode[next_encoded] == i) {
+        mem_area.WritePhys(write.image);
+        ++next_encoded;
+      } else if (image_cache_) {
+        image_cache_->Write(mem_area, write.word_offset, write.data.data(),
+                            write.data.size());
+      } else {
+        mem_area.Write(write.word_offset, write.data.data(),
+                       write.data.size());
+      }
+    }
+  } catch (const SVScoped::Error &err) {
+    std::ostringstream oss;
+    oss << "No memory found at `" << err.scope_name_ << "'";
+    if (current) {
+      oss << " (" << current->context << ")";
+    }
+    oss << ".";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+void DpiMemUtil::EncodePendingWrites(std::vector<PendingWrite> &writes,
+                                     const std::vector<size_t> &to_encode) {
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  // Each worker takes the next write which isn't encoded yet, until there are
+  // none left. The encoding parameters are held, so encoding doesn't touch
+  // the simulation.
+  auto worker = [&]() {
+    try {
+      size_t idx;
+      while ((idx = next++) < to_encode.size()) {
+        PendingWrite &write = writes[to_encode[idx]];
+        const MemArea &mem_area = *mem_areas_[write.mem_idx];
+        uint32_t width_byte = mem_area.GetWidthByte();
+        uint32_t num_words = (write.data.size() + width_byte - 1) / width_byte;
+
+        bool cached = !write.cache_entry.path.empty();
+        if (cached &&
+            MemImageCache::Load(write.cache_entry, write.data.data(),
+                                write.data.size(), num_words, &write.image) &&
+            write.image.word_offset == write.word_offset) {
+          continue;
+        }
+        write.image = mem_area.Encode(write.word_offset, write.data.data(),
+                                      write.data.size());
+        if (cached) {
+          MemImageCache::Store(write.cache_entry, write.data.data(),
+                               write.data.size(), write.image);
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      // Make the other workers stop early
+      next = to_encode.size();
+    }
+  };
+
+  size_t num_threads = std::min((size_t)load_jobs_, to_encode.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
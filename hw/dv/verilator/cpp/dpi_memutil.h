@@ -11,15 +11,38 @@
 #include <vector>
 
 #include "mem_area.h"
+#include "mem_dump.h"
+#include "mem_image_cache.h"
 #include "ranged_map.h"
 
 // Forward declaration for the Elf type from libelf.
 struct Elf;
 
-enum MemImageType {
-  kMemImageUnknown = 0,
-  kMemImageElf,
-  kMemImageVmem,
+// The contents of a staged segment
+//
+// Segments loaded from an ELF file are views into the memory-mapped file,
+// which stays mapped as long as any segment refers to it. Segments which are
+// the result of merging overlapping segments own their data.
+class SegData {
+ public:
+  SegData() : data_(nullptr), size_(0) {}
+
+  // A view of size bytes at data, which stay valid as long as owner is alive
+  SegData(std::shared_ptr<const void> owner, const uint8_t *data, size_t size)
+      : owner_(std::move(owner)), data_(data), size_(size) {}
+
+  // A segment owning its data
+  explicit SegData(std::vector<uint8_t> &&data);
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const uint8_t &operator[](size_t idx) const { return data_[idx]; }
+
+ private:
+  std::shared_ptr<const void> owner_;
+  const uint8_t *data_;
+  size_t size_;
 };
 
 // Staged data for a given memory area.
@@ -34,13 +57,13 @@ class StagedMem {
   StagedMem() : min_addr_(~(uint32_t)0), max_addr_(0) {}
 
   // Add a segment to the tracked memory
-  void AddSegment(uint32_t offset, std::vector<uint8_t> &&seg);
+  void AddSegment(uint32_t offset, SegData &&seg);
 
   // Glob together the tracked segments, interspersing them with
   // zeros, and return as a single flat array.
   std::vector<uint8_t> GetFlat() const;
 
-  typedef RangedMap<uint32_t, std::vector<uint8_t>> SegMap;
+  typedef RangedMap<uint32_t, SegData> SegMap;
 
   std::pair<uint32_t, uint32_t> GetBounds() const {
     return std::make_pair(min_addr_, max_addr_);
@@ -55,10 +78,8 @@ class StagedMem {
 /**
  * Provide various memory loading utilities for verilog simulations
  *
- * These utilities require the corresponding DPI functions:
- * simutil_memload()
- * simutil_set_mem()
- * to be defined somewhere as SystemVerilog functions.
+ * These utilities require the DPI functions used by MemArea (see
+ * prim_util_memload.svh) to be defined somewhere as SystemVerilog functions.
  */
 class DpiMemUtil {
  public:
@@ -85,6 +106,50 @@ class DpiMemUtil {
   void RegisterMemoryArea(const std::string &name, uint32_t base,
                           const MemArea *mem_area);
 
+  /**
+   * Cache encoded images of memories with ECC bits or scrambling in |dir|
+   *
+   * Loading the same ELF data into such a memory again (with the same
+   * scrambling key and nonce) then copies the cached physical image instead of
+   * encoding it again. An empty |dir| disables the cache.
+   *
+   * @see MemImageCache
+   */
+  void SetImageCacheDir(const std::string &dir);
+
+  /**
+   * Encode memory images on up to |jobs| threads
+   *
+   * With more than one job, the data for memories with ECC bits or scrambling
+   * is encoded on a pool of worker threads. Only the final writes into the
+   * simulation happen on the calling thread, in the order of the loads. This
+   * pays off most for a batch of loads (see StartLoadBatch()), where the
+   * images of several memories are encoded at the same time.
+   *
+   * The default is a single job, which encodes everything on the calling
+   * thread.
+   */
+  void SetLoadJobs(unsigned jobs);
+
+  /**
+   * Start a batch of loads
+   *
+   * Until FinishLoadBatch() is called, LoadFileToNamedMem() and
+   * LoadElfToMemories() only stage and queue their writes, so that
+   * FinishLoadBatch() can encode the images for all memories in parallel.
+   * Loads of vmem files can't be split up like this; they write everything
+   * queued before them first.
+   */
+  void StartLoadBatch();
+
+  /**
+   * Write everything queued since StartLoadBatch() to the memories
+   *
+   * If a write fails, raises a std::exception with information about what
+   * happened. The writes queued after the failing one are dropped.
+   */
+  void FinishLoadBatch();
+
   /**
    * Guess the type of the file at |path|.
    *
@@ -112,6 +177,38 @@ class DpiMemUtil {
   void LoadFileToNamedMem(bool verbose, const std::string &name,
                           const std::string &filepath, MemImageType type);
 
+  /**
+   * Is there a memory region called |name|?
+   */
+  bool IsMemoryRegistered(const std::string &name) const {
+    return name_to_mem_.count(name) != 0;
+  }
+
+  /**
+   * Get the memory area of the region called |name|, or null if there is no
+   * such region. If |base| is not null, the LMA of the region is written to
+   * it.
+   */
+  const MemArea *FindMemoryArea(const std::string &name,
+                                uint32_t *base = nullptr) const;
+
+  /**
+   * Get the names of all registered memory regions, in alphabetical order
+   */
+  std::vector<std::string> GetMemoryNames() const;
+
+  /**
+   * Dump the contents of the named memory to filepath, in the format given by
+   * type. If type is kMemImageUnknown, the format is determined from the path.
+   *
+   * The memory is read with MemArea::Read(), so the dump holds the logical
+   * contents (without ECC bits or scrambling). ELF dumps place the contents at
+   * the LMA of the memory. If the dump fails, raises a std::exception with
+   * information about what happened.
+   */
+  void DumpNamedMem(bool verbose, const std::string &name,
+                    const std::string &filepath, MemImageType type) const;
+
   /**
    * Load an ELF file, placing segments in memories by LMA.
    *
@@ -142,6 +239,21 @@ class DpiMemUtil {
   virtual void OnElfLoaded(Elf *elf_file) {}
 
  private:
+  // A write of staged data (or of fill_words zero words, if data is empty)
+  // into a memory, queued until FlushWrites().
+  struct PendingWrite {
+    size_t mem_idx;
+    uint32_t word_offset;
+    SegData data;
+    uint32_t fill_words;
+    // Describes where the data came from in error messages
+    std::string context;
+
+    // Filled in by FlushWrites() for writes which are encoded on a worker
+    MemImageCache::Entry cache_entry;
+    MemArea::PhysImage image;
+  };
+
   // Memory area registry. The maps give indices pointing into the vectors
   // (which all have the same number of elements). Note that mem_areas_ does
   // not own the objects that it points to.
@@ -150,7 +262,7 @@ class DpiMemUtil {
   std::vector<std::string> names_;
 
   std::map<std::string, size_t> name_to_mem_;
-  RangedMap<uint32_t, size_t> addr_to_mem_;
+  FlatRangedMap<uint32_t, size_t> addr_to_mem_;
 
   // Staging area, loaded by StageElf. The map is keyed by names of memories
   // stored in name_to_mem_. We also ensure that every segment in a StagedMem
@@ -159,6 +271,50 @@ class DpiMemUtil {
   std::map<std::string, StagedMem> staging_area_;
   const StagedMem empty_;
 
+  // Cache of encoded memory images, if enabled with SetImageCacheDir()
+  std::unique_ptr<MemImageCache> image_cache_;
+
+  // Writes queued by the loads in the current batch, if in_batch_ is set.
+  // Otherwise every load flushes its own writes before it returns.
+  unsigned load_jobs_ = 1;
+  bool in_batch_ = false;
+  std::vector<PendingWrite> pending_writes_;
+
+  /**
+   * Queue a write of |data| at |word_offset| of the memory at |mem_idx|
+   */
+  void QueueWrite(size_t mem_idx, uint32_t word_offset, SegData data,
+                  const std::string &context);
+
+  /**
+   * Queue the writes which store the flat array that |staged|.GetFlat() would
+   * return at word 0 of the memory at |mem_idx|
+   *
+   * The segments are written straight from where they are held and the gaps
+   * between them are zero-filled in place, so the flat array is only built if
+   * some segment doesn't start at a word boundary.
+   */
+  void QueueFlat(size_t mem_idx, const StagedMem &staged,
+                 const std::string &context);
+
+  /**
+   * Perform all queued writes, encoding them on up to load_jobs_ threads
+   *
+   * Raises a std::runtime_error if a memory can't be found in the design.
+   */
+  void FlushWrites();
+
+  /**
+   * Fill in the image of each write in |writes| which is indexed by
+   * |to_encode|, on up to load_jobs_ threads
+   *
+   * Writes with a cache_entry are loaded from the image cache if possible, and
+   * stored in it otherwise. The encoding parameters of the memories must be
+   * held (see MemArea::HoldEncoding()).
+   */
+  void EncodePendingWrites(std::vector<PendingWrite> &writes,
+                           const std::vector<size_t> &to_encode);
+
   /**
    * Find the index of a memory area containing the given segment's addresses.
    * Raises a std::exception if none is found.
@@ -4,10 +4,11 @@
 
 #include "ecc32_mem_area.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
-#include <stdexcept>
 
+#include "mem_word_codec.h"
 #include "secded_enc.h"
 
 Ecc32MemArea::Ecc32MemArea(const std::string &scope, uint32_t size,
@@ -25,192 +26,116 @@ Ecc32MemArea::Ecc32MemArea(const std::string &scope, uint32_t size,
   assert(phy_width_bits <= SV_MEM_WIDTH_BITS);
 }
 
-void Ecc32MemArea::LoadVmem(const std::string &path) const {
-  throw std::runtime_error(
-      "vmem files are not supported for memories with ECC bits");
-}
-
 Ecc32MemArea::EccWords Ecc32MemArea::ReadWithIntegrity(
     uint32_t word_offset, uint32_t num_words) const {
   assert(word_offset + num_words <= num_words_);
 
-  // See MemArea::Write for an explanation for this buffer.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
-
-  EccWords ret;
-  ret.reserve(num_words);
-
-  for (uint32_t i = 0; i < num_words; ++i) {
-    uint32_t src_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(src_word);
-
-    ReadToMinibuf(minibuf, phys_addr);
-    ReadBufferWithIntegrity(ret, minibuf, src_word);
-  }
+  uint32_t width_32 = width_byte_ / 4;
+  EccWords ret((size_t)num_words * width_32);
+
+  // The words of a block may not be in logical order, so each one is read
+  // into word and then copied to its place in ret.
+  EccWords word;
+  word.reserve(width_32);
+  ReadWords(word_offset, num_words,
+            [&](const uint8_t *block, const uint32_t *src_words, uint32_t n) {
+              for (uint32_t j = 0; j < n; ++j) {
+                word.clear();
+                ReadBufferWithIntegrity(word, &block[j * SV_MEM_WIDTH_BYTES],
+                                        src_words[j]);
+                std::copy(word.begin(), word.end(),
+                          ret.begin() + (size_t)(src_words[j] - word_offset) *
+                                            width_32);
+              }
+            });
 
   return ret;
 }
 
 void Ecc32MemArea::WriteWithIntegrity(uint32_t word_offset,
                                       const EccWords &data) const {
-  // See MemArea::Write for an explanation for this buffer.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
-
   uint32_t width_32 = width_byte_ / 4;
   uint32_t to_write = data.size() / width_32;
 
   assert((data.size() % width_32) == 0);
   assert(word_offset + to_write <= num_words_);
 
-  for (uint32_t i = 0; i < to_write; ++i) {
-    uint32_t dst_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(dst_word);
-
-    WriteBufferWithIntegrity(minibuf, data, i * width_32, dst_word);
-    WriteFromMinibuf(phys_addr, minibuf, dst_word);
-  }
-}
-
-// Zero enough of the buffer to fill it with a word using insert_bits
-static void zero_buffer(uint8_t buf[SV_MEM_WIDTH_BYTES], uint32_t width_byte) {
-  // The insert_bits routine assumes that the buffer will have been zeroed, so
-  // do that here. Note that this buffer has (width_byte / 4) words, each of
-  // which is 39 bits long. Divide this by 8, rounding up.
-  size_t phys_size_bytes = (39 * (width_byte / 4) + 7) / 8;
-  memset(buf, 0, phys_size_bytes);
-}
-
-// Add bits to buf at bit_idx
-//
-// buf is assumed to be little-endian, so bit_idx 0 will refer to the bottom
-// bit of buf[0] and bit_idx 15 will refer to the top bit of buf[1].
-//
-// This takes the bottom count bits from new_bits (where count <= 8). It
-// assumes that the relevant place in buf is zeroed (simplifying the
-// read-modify-write cycle).
-static void insert_bits(uint8_t *buf, unsigned bit_idx, uint8_t new_bits,
-                        unsigned count) {
-  assert(count <= 8);
-
-  buf += bit_idx / 8;
-  bit_idx = bit_idx % 8;
-
-  while (count) {
-    unsigned space_avail = 8 - bit_idx;
-    unsigned to_take = std::min(space_avail, count);
-
-    uint8_t masked = ((1 << to_take) - 1) & new_bits;
-    uint8_t shifted = masked << bit_idx;
-
-    *buf |= shifted;
-
-    ++buf;
-    bit_idx = 0;
-    count -= to_take;
-    new_bits >>= to_take;
-  }
-}
-
-// Add 4 bytes to buf from bytes at bit_idx, plus check bits
-static void insert_word(uint8_t *buf, unsigned bit_idx, const uint8_t *bytes,
-                        uint8_t check_bits) {
-  assert((check_bits >> 7) == 0);
-  for (int i = 0; i < 4; ++i) {
-    insert_bits(buf, bit_idx + 8 * i, bytes[i], 8);
-  }
-  insert_bits(buf, bit_idx + 8 * 4, check_bits, 7);
-}
-
-// Extract bits from buf at bit_idx
-static uint8_t extract_bits(const uint8_t *buf, unsigned bit_idx,
-                            unsigned count) {
-  assert(count <= 8);
-
-  uint8_t ret = 0;
-  unsigned out_idx = 0;
-
-  buf += bit_idx / 8;
-  bit_idx = bit_idx % 8;
-
-  while (count) {
-    unsigned bits_avail = 8 - bit_idx;
-    unsigned to_take = std::min(bits_avail, count);
-
-    uint8_t shifted = *buf >> bit_idx;
-    uint8_t masked = shifted & ((1 << to_take) - 1);
-
-    ret |= masked << out_idx;
-
-    ++buf;
-    bit_idx = 0;
-    count -= to_take;
-    out_idx += to_take;
-  }
-
-  return ret;
+  WriteWords(word_offset, to_write,
+             [&](uint8_t *block, const uint32_t *dst_words, uint32_t n) {
+               for (uint32_t j = 0; j < n; ++j) {
+                 WriteBufferWithIntegrity(
+                     &block[j * SV_MEM_WIDTH_BYTES], data,
+                     (dst_words[j] - word_offset) * width_32, dst_words[j]);
+               }
+             });
 }
 
 void Ecc32MemArea::WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                               const std::vector<uint8_t> &data,
+                               const uint8_t *data, size_t data_size,
                                size_t start_idx, uint32_t dst_word) const {
-  zero_buffer(buf, width_byte_);
-  for (uint32_t i = 0; i < width_byte_ / 4; ++i) {
-    const uint8_t *src_data = &data[start_idx + 4 * i];
-    insert_word(buf, 39 * i, src_data, enc_secded_inv_39_32(src_data));
+  // Zero-extend a partial last word
+  uint8_t word[SV_MEM_WIDTH_BYTES];
+  const uint8_t *src = &data[start_idx];
+  if (data_size - start_idx < width_byte_) {
+    memset(word, 0, sizeof word);
+    memcpy(word, src, data_size - start_idx);
+    src = word;
   }
+  PackEcc32Words(buf, src, nullptr, width_byte_ / 4, 1);
+}
+
+void Ecc32MemArea::WriteBufferBlock(uint8_t *block, const uint8_t *data,
+                                    const uint32_t *dst_words,
+                                    uint32_t num_words) const {
+  PackEcc32Words(block, data, nullptr, width_byte_ / 4, num_words);
 }
 
 void Ecc32MemArea::WriteBufferWithIntegrity(uint8_t buf[SV_MEM_WIDTH_BYTES],
                                             const EccWords &data,
                                             size_t start_idx,
                                             uint32_t dst_word) const {
-  uint8_t src_data[4];
+  uint32_t width_32 = width_byte_ / 4;
+  uint8_t src_data[SV_MEM_WIDTH_BYTES];
+  uint8_t check_bits[SV_MEM_WIDTH_BYTES / 4];
 
-  zero_buffer(buf, width_byte_);
-  for (uint32_t i = 0; i < width_byte_ / 4; ++i) {
+  for (uint32_t i = 0; i < width_32; ++i) {
     const EccWord &word = data[start_idx + i];
     for (uint32_t j = 0; j < 4; ++j) {
-      src_data[j] = (word.second >> 8 * j) & 0xff;
+      src_data[4 * i + j] = (word.second >> 8 * j) & 0xff;
     }
-    uint8_t check_bits = enc_secded_inv_39_32(src_data);
-
-    // Invert (and thus corrupt) check bits if needed
-    if (!word.first)
-      check_bits ^= 0x7f;
+  }
+  enc_secded_inv_39_32_buf(src_data, check_bits, width_32);
 
-    insert_word(buf, 39 * i, src_data, check_bits);
+  // Invert (and thus corrupt) check bits if needed
+  for (uint32_t i = 0; i < width_32; ++i) {
+    if (!data[start_idx + i].first)
+      check_bits[i] ^= 0x7f;
   }
+
+  PackEcc32Words(buf, src_data, check_bits, width_32, 1);
 }
 
-void Ecc32MemArea::ReadBuffer(std::vector<uint8_t> &data,
-                              const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                              uint32_t src_word) const {
-  for (uint32_t i = 0; i < width_byte_ / 4; ++i) {
-    for (uint32_t j = 0; j < 4; ++j) {
-      data.push_back(extract_bits(buf, 39 * i + 8 * j, 8));
-    }
-  }
+void Ecc32MemArea::ReadBufferBlock(uint8_t *data, const uint8_t *block,
+                                   const uint32_t *src_words,
+                                   uint32_t num_words) const {
+  UnpackEcc32Words(data, nullptr, block, width_byte_ / 4, num_words);
 }
 
 void Ecc32MemArea::ReadBufferWithIntegrity(
     EccWords &data, const uint8_t buf[SV_MEM_WIDTH_BYTES],
     uint32_t src_word) const {
-  for (uint32_t i = 0; i < width_byte_ / 4; ++i) {
-    uint8_t buf32[4];
-    uint32_t w32 = 0;
-    for (uint32_t j = 0; j < 4; ++j) {
-      uint8_t byte = extract_bits(buf, 39 * i + 8 * j, 8);
-      buf32[j] = byte;
-      w32 |= (uint32_t)byte << 8 * j;
-    }
-
-    uint8_t exp_check_bits = enc_secded_inv_39_32(buf32);
-    uint8_t check_bits = extract_bits(buf, 39 * i + 32, 7);
-    bool good = check_bits == exp_check_bits;
+  uint32_t width_32 = width_byte_ / 4;
+  uint8_t bytes[SV_MEM_WIDTH_BYTES];
+  uint8_t check_bits[SV_MEM_WIDTH_BYTES / 4];
+
+  UnpackEcc32Words(bytes, check_bits, buf, width_32, 1);
+  for (uint32_t i = 0; i < width_32; ++i) {
+    uint8_t *buf32 = &bytes[4 * i];
+    uint32_t w32 = (uint32_t)buf32[0] | ((uint32_t)buf32[1] << 8) |
+                   ((uint32_t)buf32[2] << 16) | ((uint32_t)buf32[3] << 24);
+    // The word is returned as stored, so the correction of a single bit error
+    // in buf32 is discarded.
+    bool good = dec_secded_inv_39_32(buf32, check_bits[i]) == 0;
 
     data.push_back(std::make_pair(good, w32));
   }
@@ -22,7 +22,7 @@ class Ecc32MemArea : public MemArea {
    */
   Ecc32MemArea(const std::string &scope, uint32_t size, uint32_t width_32);
 
-  void LoadVmem(const std::string &path) const override;
+  std::string GetEncodingId() const override { return "ecc32"; }
 
   typedef std::pair<bool, uint32_t> EccWord;
   typedef std::vector<EccWord> EccWords;
@@ -54,13 +54,17 @@ class Ecc32MemArea : public MemArea {
   void WriteWithIntegrity(uint32_t word_offset, const EccWords &data) const;
 
  protected:
-  void WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                   const std::vector<uint8_t> &data, size_t start_idx,
+  void WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES], const uint8_t *data,
+                   size_t data_size, size_t start_idx,
                    uint32_t dst_word) const override;
 
-  void ReadBuffer(std::vector<uint8_t> &data,
-                  const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                  uint32_t src_word) const override;
+  void WriteBufferBlock(uint8_t *block, const uint8_t *data,
+                        const uint32_t *dst_words,
+                        uint32_t num_words) const override;
+
+  void ReadBufferBlock(uint8_t *data, const uint8_t *block,
+                       const uint32_t *src_words,
+                       uint32_t num_words) const override;
 
   /** Extract the logical words corresponding to the physical memory contents
    * in \p buf, together with validity bits. Append them to \p data.
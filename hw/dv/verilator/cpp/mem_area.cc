@@ -7,15 +7,44 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <numeric>
 #include <sstream>
 
+#include "mem_word_codec.h"
 #include "sv_scoped.h"
+#include "vmem_parser.h"
 
 // DPI exports, defined in prim_util_memload.svh
 extern "C" {
-void simutil_memload(const char *file);
-int simutil_set_mem(int index, const svBitVecVal *val);
-int simutil_get_mem(int index, svBitVecVal *val);
+int simutil_fill_mem(int index, int num_words, const svBitVecVal *val);
+int simutil_set_mem_block(int index, int num_words, const svBitVecVal *vals);
+int simutil_get_mem_block(int index, int num_words, svBitVecVal *vals);
+}
+
+// Return true if the num_words logical addresses in words are consecutive
+static bool AreConsecutive(const uint32_t *words, uint32_t num_words) {
+  for (uint32_t j = 1; j < num_words; ++j) {
+    if (words[j] != words[0] + j) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Copy the data of the words at logical addresses dst_words out of data, which
+// holds size bytes of data for consecutive words starting at word_offset, to
+// consecutive words of width_byte bytes at words. Words only partly covered by
+// data are zero-extended.
+static void GatherWords(uint8_t *words, const uint8_t *data, size_t size,
+                        uint32_t word_offset, uint32_t width_byte,
+                        const uint32_t *dst_words, uint32_t num_words) {
+  for (uint32_t j = 0; j < num_words; ++j) {
+    size_t start_idx = (size_t)(dst_words[j] - word_offset) * width_byte;
+    size_t to_copy = std::min(size - start_idx, (size_t)width_byte);
+    uint8_t *word = &words[(size_t)j * width_byte];
+    memcpy(word, &data[start_idx], to_copy);
+    memset(word + to_copy, 0, width_byte - to_copy);
+  }
 }
 
 MemArea::MemArea(const std::string &scope, uint32_t num_words,
@@ -25,29 +54,34 @@ MemArea::MemArea(const std::string &scope, uint32_t num_words,
   assert(width_byte <= SV_MEM_WIDTH_BYTES);
 }
 
-void MemArea::Write(uint32_t word_offset,
-                    const std::vector<uint8_t> &data) const {
-  // This "mini buffer" is used to transfer each write to SystemVerilog.
-  // `simutil_set_mem` takes a fixed SV_MEM_WIDTH_BITS-bit vector but it will
-  // only use the bits required for the RAM width. As an example, for a 32-bit
-  // wide RAM only elements 3:0 of `minibuf` will be written to memory. Since
-  // the simulator may still read bits from minibuf it does not use, we must
-  // use a fixed allocation of the full bit vector size to avoid an out of
-  // bounds access.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
-
-  uint32_t data_words = (data.size() + width_byte_ - 1) / width_byte_;
+void MemArea::Write(uint32_t word_offset, const uint8_t *data,
+                    size_t size) const {
+  uint32_t data_words = (size + width_byte_ - 1) / width_byte_;
+  uint32_t full_words = size / width_byte_;
   assert(word_offset + data_words <= num_words_);
 
-  for (uint32_t i = 0; i < data_words; ++i) {
-    uint32_t dst_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(dst_word);
+  // The data of a block whose words aren't consecutive in data
+  std::vector<uint8_t> gathered((size_t)SV_MEM_BLOCK_WORDS * width_byte_);
+  WriteWords(word_offset, data_words,
+             [&](uint8_t *block, const uint32_t *dst_words, uint32_t n) {
+               if (!AreConsecutive(dst_words, n)) {
+                 GatherWords(gathered.data(), data, size, word_offset,
+                             width_byte_, dst_words, n);
+                 WriteBufferBlock(block, gathered.data(), dst_words, n);
+                 return;
+               }
 
-    WriteBuffer(minibuf, data, i * width_byte_, dst_word);
-    WriteFromMinibuf(phys_addr, minibuf, dst_word);
-  }
+               // Only the last word of the data can be partial
+               uint32_t i = dst_words[0] - word_offset;
+               uint32_t block_full = std::min(n, full_words - i);
+               WriteBufferBlock(block, &data[(size_t)i * width_byte_],
+                                dst_words, block_full);
+               if (block_full < n) {
+                 WriteBuffer(&block[block_full * SV_MEM_WIDTH_BYTES], data,
+                             size, (size_t)full_words * width_byte_,
+                             dst_words[block_full]);
+               }
+             });
 }
 
 std::vector<uint8_t> MemArea::Read(uint32_t word_offset,
@@ -57,35 +91,314 @@ std::vector<uint8_t> MemArea::Read(uint32_t word_offset,
   uint32_t num_bytes = width_byte_ * num_words;
   assert(num_words <= num_bytes);
 
-  // See Write for an explanation for this buffer.
-  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(width_byte_ <= sizeof minibuf);
+  std::vector<uint8_t> ret(num_bytes);
+
+  // The data of a block whose words aren't consecutive in ret
+  std::vector<uint8_t> scattered((size_t)SV_MEM_BLOCK_WORDS * width_byte_);
+  ReadWords(word_offset, num_words,
+            [&](const uint8_t *block, const uint32_t *src_words, uint32_t n) {
+              if (AreConsecutive(src_words, n)) {
+                size_t idx = (size_t)(src_words[0] - word_offset) * width_byte_;
+                ReadBufferBlock(&ret[idx], block, src_words, n);
+                return;
+              }
+
+              ReadBufferBlock(scattered.data(), block, src_words, n);
+              for (uint32_t j = 0; j < n; ++j) {
+                size_t idx = (size_t)(src_words[j] - word_offset) * width_byte_;
+                memcpy(&ret[idx], &scattered[(size_t)j * width_byte_],
+                       width_byte_);
+              }
+            });
+
+  return ret;
+}
 
-  std::vector<uint8_t> ret;
-  ret.reserve(num_bytes);
+void MemArea::WriteWords(
+    uint32_t word_offset, uint32_t num_words,
+    const std::function<void(uint8_t *, const uint32_t *, uint32_t)> &fill)
+    const {
+  assert(word_offset + num_words <= num_words_);
+
+  // This block buffer is used to transfer the writes to SystemVerilog. It
+  // holds SV_MEM_BLOCK_WORDS words of SV_MEM_WIDTH_BYTES bytes each, matching
+  // the fixed SV_MEM_BLOCK_BYTES-byte vector `simutil_set_mem_block` takes,
+  // but only the first num_words words and, in each of them, only the bits
+  // required for the RAM width are written to memory. As an example, for a
+  // 32-bit wide RAM only bytes 3:0 of each word will be written to memory.
+  // Since the simulator may still read the whole vector, we must use a fixed
+  // allocation of the full block size to avoid an out of bounds access.
+  uint8_t block[SV_MEM_BLOCK_BYTES];
+  memset(block, 0, sizeof block);
+  assert(width_byte_ <= SV_MEM_WIDTH_BYTES);
+
+  // Read scrambling keys and the like once for the whole transfer
+  TransferHold hold(*this);
+  ForEachBlock(word_offset, num_words,
+               [&](uint32_t phys_addr, const uint32_t *dst_words, uint32_t n) {
+                 fill(block, dst_words, n);
+                 WriteBlock(phys_addr, block, n, dst_words[0]);
+               });
+}
+
+void MemArea::ReadWords(
+    uint32_t word_offset, uint32_t num_words,
+    const std::function<void(const uint8_t *, const uint32_t *, uint32_t)>
+        &extract) const {
+  assert(word_offset + num_words <= num_words_);
+
+  // See WriteWords for an explanation for this buffer.
+  uint8_t block[SV_MEM_BLOCK_BYTES];
+  memset(block, 0, sizeof block);
+  assert(width_byte_ <= SV_MEM_WIDTH_BYTES);
+
+  // Read scrambling keys and the like once for the whole transfer
+  TransferHold hold(*this);
+  ForEachBlock(word_offset, num_words,
+               [&](uint32_t phys_addr, const uint32_t *src_words, uint32_t n) {
+                 ReadBlock(block, phys_addr, n);
+                 extract(block, src_words, n);
+               });
+}
 
-  for (uint32_t i = 0; i < num_words; ++i) {
-    uint32_t src_word = word_offset + i;
-    uint32_t phys_addr = ToPhysAddr(src_word);
+void MemArea::ForEachBlock(
+    uint32_t word_offset, uint32_t num_words,
+    const std::function<void(uint32_t, const uint32_t *, uint32_t)> &block)
+    const {
+  // Logical address of each word of the current block
+  uint32_t words[SV_MEM_BLOCK_WORDS];
 
-    ReadToMinibuf(minibuf, phys_addr);
-    ReadBuffer(ret, minibuf, src_word);
+  // Walking the memory in physical address order looks up every physical
+  // address of the memory, so only do that if the transfer is large enough for
+  // the full blocks to make up for it.
+  const std::vector<uint32_t> *logical_addrs = GetLogicalAddrs();
+  if (logical_addrs &&
+      (uint64_t)num_words * SV_MEM_BLOCK_WORDS >= logical_addrs->size()) {
+    uint32_t num_phys_addrs = logical_addrs->size();
+    auto in_transfer = [&](uint32_t phys_addr) {
+      return (*logical_addrs)[phys_addr] - word_offset < num_words;
+    };
+
+    uint32_t phys_addr = 0;
+    while (true) {
+      // Skip words which aren't part of the transfer
+      while (phys_addr < num_phys_addrs && !in_transfer(phys_addr)) {
+        ++phys_addr;
+      }
+      if (phys_addr == num_phys_addrs) {
+        return;
+      }
+
+      // Gather the following words of the transfer
+      uint32_t block_phys_addr = phys_addr;
+      uint32_t block_words = 0;
+      do {
+        words[block_words++] = (*logical_addrs)[phys_addr++];
+      } while (block_words < SV_MEM_BLOCK_WORDS &&
+               phys_addr < num_phys_addrs && in_transfer(phys_addr));
+
+      block(block_phys_addr, words, block_words);
+    }
   }
 
-  return ret;
+  uint32_t i = 0;
+  uint32_t next_phys_addr = num_words ? ToPhysAddr(word_offset) : 0;
+  while (i < num_words) {
+    // Gather the following words with consecutive physical addresses
+    uint32_t block_phys_addr = next_phys_addr;
+    uint32_t block_words = 0;
+    do {
+      words[block_words] = word_offset + i + block_words;
+      ++block_words;
+      if (i + block_words == num_words) {
+        break;
+      }
+      next_phys_addr = ToPhysAddr(word_offset + i + block_words);
+    } while (block_words < SV_MEM_BLOCK_WORDS &&
+             next_phys_addr == block_phys_addr + block_words);
+
+    block(block_phys_addr, words, block_words);
+    i += block_words;
+  }
+}
+
+MemArea::PhysImage MemArea::Encode(uint32_t word_offset, const uint8_t *data,
+                                   size_t size) const {
+  uint32_t data_words = (size + width_byte_ - 1) / width_byte_;
+  uint32_t full_words = size / width_byte_;
+  assert(word_offset + data_words <= num_words_);
+
+  TransferHold hold(*this);
+  PhysImage image;
+  image.word_offset = word_offset;
+  image.phys_addrs.resize(data_words);
+  image.bits.resize((size_t)data_words * SV_MEM_WIDTH_BYTES, 0);
+  std::vector<uint32_t> dst_words(data_words);
+  for (uint32_t i = 0; i < data_words; ++i) {
+    dst_words[i] = word_offset + i;
+    image.phys_addrs[i] = ToPhysAddr(word_offset + i);
+  }
+  // The image has the same layout as a block buffer, so all complete words
+  // can be encoded at once.
+  WriteBufferBlock(image.bits.data(), data, dst_words.data(), full_words);
+  if (full_words < data_words) {
+    WriteBuffer(&image.bits[(size_t)full_words * SV_MEM_WIDTH_BYTES], data,
+                size, (size_t)full_words * width_byte_,
+                word_offset + full_words);
+  }
+  return image;
+}
+
+void MemArea::WritePhys(const PhysImage &image) const {
+  uint32_t num_words = image.phys_addrs.size();
+  assert(image.bits.size() == (size_t)num_words * SV_MEM_WIDTH_BYTES);
+  assert(image.word_offset + num_words <= num_words_);
+
+  // See WriteWords for an explanation for this buffer.
+  uint8_t block[SV_MEM_BLOCK_BYTES];
+  memset(block, 0, sizeof block);
+
+  // Write the words in physical address order, so that blocks are full even
+  // if the physical addresses of logically consecutive words aren't
+  // consecutive (e.g. for scrambled memories).
+  std::vector<uint32_t> order(num_words);
+  std::iota(order.begin(), order.end(), 0);
+  if (!std::is_sorted(image.phys_addrs.begin(), image.phys_addrs.end())) {
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return image.phys_addrs[a] < image.phys_addrs[b];
+    });
+  }
+
+  uint32_t i = 0;
+  while (i < num_words) {
+    // Gather the following words with consecutive physical addresses
+    uint32_t block_phys_addr = image.phys_addrs[order[i]];
+    uint32_t block_words = 1;
+    while (block_words < SV_MEM_BLOCK_WORDS && i + block_words < num_words &&
+           image.phys_addrs[order[i + block_words]] ==
+               block_phys_addr + block_words) {
+      ++block_words;
+    }
+
+    for (uint32_t j = 0; j < block_words; ++j) {
+      memcpy(&block[(size_t)j * SV_MEM_WIDTH_BYTES],
+             &image.bits[(size_t)order[i + j] * SV_MEM_WIDTH_BYTES],
+             SV_MEM_WIDTH_BYTES);
+    }
+    WriteBlock(block_phys_addr, block, block_words,
+               image.word_offset + order[i]);
+    i += block_words;
+  }
+}
+
+void MemArea::Fill(uint32_t word_offset, uint32_t num_words,
+                   uint8_t value) const {
+  assert(word_offset + num_words <= num_words_);
+  if (!num_words) {
+    return;
+  }
+
+  // Encode a single word; the physical contents are the same for every word.
+  // See WriteWords for an explanation for the size of this buffer.
+  uint8_t minibuf[SV_MEM_WIDTH_BYTES];
+  memset(minibuf, 0, sizeof minibuf);
+  std::vector<uint8_t> word(width_byte_, value);
+  WriteBuffer(minibuf, word.data(), word.size(), 0, word_offset);
+
+  SVScoped scoped(scope_);
+  if (!simutil_fill_mem(ToPhysAddr(word_offset), num_words,
+                        (const svBitVecVal *)minibuf)) {
+    std::ostringstream oss;
+    oss << "Could not fill " << num_words << " memory words at byte offset 0x"
+        << std::hex << word_offset * width_byte_ << ".";
+    throw std::runtime_error(oss.str());
+  }
 }
 
 void MemArea::LoadVmem(const std::string &path) const {
-  SVScoped scoped(scope_.c_str());
-  // TODO: Add error handling.
-  simutil_memload(path.c_str());
+  // The widest word the memory can have
+  const uint32_t kMaxWordBytes = (SV_MEM_WIDTH_BITS + 7) / 8;
+  // Words at consecutive addresses are collected into runs of up to this
+  // many words, each of which is written with a single call to Write() or
+  // WritePhys().
+  const uint32_t kRunWords = 4096;
+
+  VmemParser parser(path, kMaxWordBytes);
+  uint8_t word[kMaxWordBytes];
+  uint32_t addr, num_digits;
+
+  // Set by the first word: whether the file holds physical words, written
+  // as they are, rather than logical words, which are encoded.
+  bool physical = false;
+  bool first = true;
+
+  uint32_t run_start = 0;
+  uint32_t run_words = 0;
+  std::vector<uint8_t> data;
+  PhysImage image;
+  auto flush = [&]() {
+    if (!run_words) {
+      return;
+    }
+    if (physical) {
+      image.word_offset = run_start;
+      WritePhys(image);
+      image.phys_addrs.clear();
+      image.bits.clear();
+    } else {
+      Write(run_start, data.data(), data.size());
+      data.clear();
+    }
+    run_words = 0;
+  };
+
+  TransferHold hold(*this);
+  while (parser.Next(&addr, word, &num_digits)) {
+    if (first) {
+      physical = num_digits > 2 * width_byte_;
+      first = false;
+    }
+
+    if (addr >= num_words_) {
+      std::ostringstream oss;
+      oss << "word address 0x" << std::hex << addr
+          << " is beyond the end of the memory, which has 0x" << num_words_
+          << " words.";
+      parser.Error(oss.str());
+    }
+    if (!physical && std::any_of(word + width_byte_, word + kMaxWordBytes,
+                                 [](uint8_t byte) { return byte != 0; })) {
+      std::ostringstream oss;
+      oss << "word is wider than the memory (" << GetWidth()
+          << " bits), but the first word in the file isn't.";
+      parser.Error(oss.str());
+    }
+
+    if (run_words == kRunWords ||
+        (run_words && addr != run_start + run_words)) {
+      flush();
+    }
+    if (!run_words) {
+      run_start = addr;
+    }
+
+    if (physical) {
+      size_t offset = image.bits.size();
+      image.bits.resize(offset + SV_MEM_WIDTH_BYTES, 0);
+      memcpy(&image.bits[offset], word, kMaxWordBytes);
+      image.phys_addrs.push_back(addr);
+    } else {
+      data.insert(data.end(), word, word + width_byte_);
+    }
+    ++run_words;
+  }
+  flush();
 }
 
 void MemArea::WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                          const std::vector<uint8_t> &data, size_t start_idx,
-                          uint32_t dst_word) const {
-  size_t words_left = data.size() - start_idx;
+                          const uint8_t *data, size_t data_size,
+                          size_t start_idx, uint32_t dst_word) const {
+  size_t words_left = data_size - start_idx;
   size_t to_copy = std::min(words_left, (size_t)width_byte_);
   if (to_copy < width_byte_) {
     memset(buf, 0, SV_MEM_WIDTH_BYTES);
@@ -93,31 +406,43 @@ void MemArea::WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
   memcpy(buf, &data[start_idx], to_copy);
 }
 
-void MemArea::ReadBuffer(std::vector<uint8_t> &data,
-                         const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                         uint32_t src_word) const {
-  // Append the first width_byte_ bytes of buf to data.
-  std::copy_n(reinterpret_cast<const char *>(buf), width_byte_,
-              std::back_inserter(data));
+void MemArea::WriteBufferBlock(uint8_t *block, const uint8_t *data,
+                               const uint32_t *dst_words,
+                               uint32_t num_words) const {
+  PackPlainWords(block, data, width_byte_, num_words);
 }
 
-void MemArea::ReadToMinibuf(uint8_t *minibuf, uint32_t phys_addr) const {
+void MemArea::ReadBufferBlock(uint8_t *data, const uint8_t *block,
+                              const uint32_t *src_words,
+                              uint32_t num_words) const {
+  UnpackPlainWords(data, block, width_byte_, num_words);
+}
+
+void MemArea::ReadBlock(uint8_t buf[SV_MEM_BLOCK_BYTES], uint32_t phys_addr,
+                        uint32_t num_words) const {
+  assert(num_words <= SV_MEM_BLOCK_WORDS);
+
   SVScoped scoped(scope_);
-  if (!simutil_get_mem(phys_addr, (svBitVecVal *)minibuf)) {
+  if (!simutil_get_mem_block(phys_addr, num_words, (svBitVecVal *)buf)) {
     std::ostringstream oss;
-    oss << "Could not read memory word at physical index 0x" << std::hex
-        << phys_addr << ".";
+    oss << "Could not read " << num_words
+        << " memory words at physical index 0x" << std::hex << phys_addr
+        << ".";
     throw std::runtime_error(oss.str());
   }
 }
 
-void MemArea::WriteFromMinibuf(uint32_t phys_addr, const uint8_t *minibuf,
-                               uint32_t dst_word) const {
+void MemArea::WriteBlock(uint32_t phys_addr,
+                         const uint8_t buf[SV_MEM_BLOCK_BYTES],
+                         uint32_t num_words, uint32_t dst_word) const {
+  assert(num_words <= SV_MEM_BLOCK_WORDS);
+
   SVScoped scoped(scope_);
-  if (!simutil_set_mem(phys_addr, (const svBitVecVal *)minibuf)) {
+  if (!simutil_set_mem_block(phys_addr, num_words,
+                             (const svBitVecVal *)buf)) {
     std::ostringstream oss;
-    oss << "Could not set memory at byte offset 0x" << std::hex
-        << dst_word * width_byte_ << ".";
+    oss << "Could not set " << num_words << " memory words at byte offset 0x"
+        << std::hex << dst_word * width_byte_ << ".";
     throw std::runtime_error(oss.str());
   }
 }
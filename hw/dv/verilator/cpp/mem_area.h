@@ -6,6 +6,7 @@
 #define OPENTITAN_HW_DV_VERILATOR_CPP_MEM_AREA_H_
 
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,13 @@
 // using the svBitVecVal type, we have to round up to the next 32-bit word.
 #define SV_MEM_WIDTH_BYTES (4 * ((SV_MEM_WIDTH_BITS + 31) / 32))
 
+// This is the maximum number of consecutive memory words that are passed
+// between C++ and SystemVerilog in a single call to simutil_set_mem_block or
+// simutil_get_mem_block. Each word occupies SV_MEM_WIDTH_BYTES bytes in the
+// transfer buffer. This must match prim_util_memload.svh.
+#define SV_MEM_BLOCK_WORDS 64
+#define SV_MEM_BLOCK_BYTES (SV_MEM_BLOCK_WORDS * SV_MEM_WIDTH_BYTES)
+
 /**
  * A "memory area", representing a memory in the simulated design.
  */
@@ -27,8 +35,7 @@ class MemArea {
    *
    * @param scope  The SystemVerilog scope where the instantiated memory can be
    *               found. This needs to support the DPI-C interfaces \c
-   *               simutil_memload and \c simutil_set_mem (used for vmem and
-   *               ELF files, respectively).
+   *               simutil_set_mem_block and \c simutil_get_mem_block.
    *
    * @param size   The size of the memory in bytes (must be positive and a
    *               multiple of \p width_byte)
@@ -42,8 +49,8 @@ class MemArea {
   /** Write data to this memory area at the given word offset
    *
    * This assumes that the result will fit in the memory. If the scope cannot
-   * be set, this throws an SVScoped::Error. If a call to \c simutil_set_mem
-   * fails, this throws a \c std::runtime_error.
+   * be set, this throws an SVScoped::Error. If a call to \c
+   * simutil_set_mem_block fails, this throws a \c std::runtime_error.
    *
    * @param word_offset The offset, in words, of the first word that should be
    *                    written.
@@ -52,8 +59,19 @@ class MemArea {
    *                    multiple of \p width_byte, the last word will be
    *                    zero-extended.
    */
-  virtual void Write(uint32_t word_offset,
-                     const std::vector<uint8_t> &data) const;
+  void Write(uint32_t word_offset, const std::vector<uint8_t> &data) const {
+    Write(word_offset, data.data(), data.size());
+  }
+
+  /** Write \p size bytes at \p data to this memory area at the given word
+   * offset
+   *
+   * This is equivalent to the vector version of Write(), but allows writing
+   * data which isn't held in a vector (like a memory-mapped file) without
+   * copying it first.
+   */
+  virtual void Write(uint32_t word_offset, const uint8_t *data,
+                     size_t size) const;
 
   /** Read data from this memory area, starting at the given offset.
    *
@@ -61,7 +79,7 @@ class MemArea {
    * memory. Returns a vector with <tt>num_words * width_byte_</tt> elements.
    *
    * If the scope cannot be set, this throws an SVScoped::Error. If a call to
-   * simutil_get_mem fails, this throws a std::runtime_error.
+   * simutil_get_mem_block fails, this throws a std::runtime_error.
    *
    * @param word_offset The offset, in words, of the first word that should be
    *                    written.
@@ -71,7 +89,105 @@ class MemArea {
   virtual std::vector<uint8_t> Read(uint32_t word_offset,
                                     uint32_t num_words) const;
 
-  /** Use \c simutil_memload to load a vmem file into the memory */
+  /** An encoded image of a range of memory words
+   *
+   * This holds the physical address and the physical memory bits of each word,
+   * in the layout used for DPI transfers, so that the image can be written to
+   * the memory again without encoding it again.
+   */
+  struct PhysImage {
+    uint32_t word_offset;              ///< Logical address of the first word
+    std::vector<uint32_t> phys_addrs;  ///< Physical address of each word
+    std::vector<uint8_t> bits;  ///< SV_MEM_WIDTH_BYTES bytes for each word
+  };
+
+  /** Encode data like Write() would, but return the result
+   *
+   * @param word_offset The offset, in words, of the first word that should be
+   *                    written.
+   *
+   * @param data        The data that should be written.
+   *
+   * @param size        The size of \p data in bytes. If this is not a
+   *                    multiple of \p width_byte, the last word will be
+   *                    zero-extended.
+   */
+  PhysImage Encode(uint32_t word_offset, const uint8_t *data,
+                   size_t size) const;
+
+  /** Write an image returned by Encode() to the memory
+   *
+   * Errors are reported like for Write().
+   */
+  void WritePhys(const PhysImage &image) const;
+
+  /** Read the parameters of the encoding from the design and hold them
+   *
+   * Until ReleaseEncoding() is called, Encode() and GetEncodingId() use the
+   * held parameters (like scrambling keys) rather than reading them from the
+   * design again. Encode() then doesn't access the simulation at all, so it
+   * can run on another thread. The default implementation does nothing,
+   * since the encoding of a plain memory has no parameters.
+   */
+  virtual void HoldEncoding() const {}
+
+  /** Stop holding the parameters read by HoldEncoding() */
+  virtual void ReleaseEncoding() const {}
+
+  /** Return true if the parameters of the encoding are held
+   *
+   * Transfers (like Write() and Read()) hold the encoding for their duration
+   * if the caller doesn't, so that they read the parameters from the design
+   * once rather than once for every word. This lets them tell whether the
+   * caller does.
+   */
+  virtual bool IsEncodingHeld() const { return false; }
+
+  /** Get a string which identifies how data is encoded for this memory
+   *
+   * Memories with the same encoding ID and geometry encode the same data at
+   * the same location to the same physical image. This is empty for memories
+   * which store data unchanged, where encoding is just a copy.
+   */
+  virtual std::string GetEncodingId() const { return ""; }
+
+  /** Fill words of this memory area with a constant byte value
+   *
+   * This is equivalent to writing <tt>num_words * width_byte</tt> bytes of
+   * \p value at \p word_offset, e.g. to erase a flash bank, but the
+   * simulator replicates a single encoded word with one call to \c
+   * simutil_fill_mem. Memories whose physical words depend on their address
+   * (e.g. scrambled memories) override this.
+   *
+   * If the scope cannot be set, this throws an SVScoped::Error. If the call to
+   * \c simutil_fill_mem fails, this throws a \c std::runtime_error.
+   *
+   * @param word_offset The offset, in words, of the first word that should be
+   *                    written.
+   *
+   * @param num_words   The number of words to write.
+   *
+   * @param value       The value of every byte.
+   */
+  virtual void Fill(uint32_t word_offset, uint32_t num_words,
+                    uint8_t value) const;
+
+  /** Load a vmem file into the memory
+   *
+   * The file is parsed here rather than with $readmemh in the simulator, and
+   * the words are transferred in blocks like for Write().
+   *
+   * The width of the first word in the file decides how the file is
+   * interpreted. If it is written with no more digits than a logical word
+   * has, the file holds logical words, which are encoded (with ECC bits or
+   * scrambling) and written to their logical address. Otherwise, the file
+   * holds physical words (for example a pre-scrambled ROM image), which are
+   * written unchanged to their physical address, like $readmemh would.
+   *
+   * If the file is malformed or an address is out of range, this throws a \c
+   * std::runtime_error with the line number. Other errors are reported like
+   * for Write().
+   */
   virtual void LoadVmem(const std::string &path) const;
 
   const std::string &GetScope() const { return scope_; }
@@ -93,32 +209,58 @@ class MemArea {
    * every bit of buf that will be used by the memory, but needn't clear bits
    * further up (this is done outside of the loop).
    *
+   * This is used for single words: by Fill() and for a last word which is
+   * only partly covered by the data being written. Other words are encoded
+   * with WriteBufferBlock().
+   *
    * @param buf       Destination buffer
    * @param data      A large buffer that contains the data to be written
+   * @param data_size The size of \p data in bytes
    * @param start_idx An offset into \p data for the start of the memory word
    * @param dst_word  Logical address of the location being written
    */
   virtual void WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                           const std::vector<uint8_t> &data, size_t start_idx,
-                           uint32_t dst_word) const;
+                           const uint8_t *data, size_t data_size,
+                           size_t start_idx, uint32_t dst_word) const;
 
-  /** Extract the logical memory contents corresponding to the physical
-   * memory contents in \p buf and append them to \p data.
+  /** Write to the slots of \p block with the data that should be copied to
+   * the physical memory for \p num_words memory words.
    *
-   * The default implementation just uses \c std::copy_n to copy the data
-   * across. Other implementations might undo scrambling, remove ECC bits or
-   * similar.
+   * This is the block version of WriteBuffer(), which Write() and Encode()
+   * use for all words that are completely covered by their data, so that
+   * encoding costs one virtual call per block rather than one per word. The
+   * default implementation copies whole words with PackPlainWords(). Classes
+   * which override WriteBuffer() must override this too.
    *
-   * @param data     The target, onto which the extracted memory contents
-   *                 should be appended.
+   * @param block     Destination buffer, with SV_MEM_WIDTH_BYTES bytes for
+   *                  each word
+   * @param data      The <tt>num_words * width_byte</tt> bytes of logical data
+   *                  to write
+   * @param dst_words Logical address of each word. These needn't be
+   *                  consecutive (see GetLogicalAddrs()).
+   * @param num_words The number of words
+   */
+  virtual void WriteBufferBlock(uint8_t *block, const uint8_t *data,
+                                const uint32_t *dst_words,
+                                uint32_t num_words) const;
+
+  /** Extract the logical memory contents corresponding to the physical
+   * memory contents of \p num_words memory words in \p block and write them
+   * to \p data.
    *
-   * @param buf      Source buffer (physical memory bits)
+   * The default implementation copies whole words with UnpackPlainWords().
+   * Other implementations might undo scrambling, remove ECC bits or similar.
    *
-   * @param src_word Logical address of the location being read
+   * @param data      The target, with space for <tt>num_words *
+   *                  width_byte</tt> bytes.
+   * @param block     Source buffer (physical memory bits), with
+   *                  SV_MEM_WIDTH_BYTES bytes for each word
+   * @param src_words Logical address of each word
+   * @param num_words The number of words
    */
-  virtual void ReadBuffer(std::vector<uint8_t> &data,
-                          const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                          uint32_t src_word) const;
+  virtual void ReadBufferBlock(uint8_t *data, const uint8_t *block,
+                               const uint32_t *src_words,
+                               uint32_t num_words) const;
 
   /** Convert a logical address to physical address
    *
@@ -131,20 +273,118 @@ class MemArea {
     return logical_addr;
   }
 
-  /** Read the memory word at phys_addr into minibuf
+  /** Get the logical address of each physical address, if it is known
    *
-   * minibuf should be at least SV_MEM_WIDTH_BYTES in size. See the
-   * implementation of MemArea::Write() for the details.
+   * Memories whose logical and physical addresses are in a different order
+   * (like scrambled memories) return a table, indexed by physical address,
+   * while their encoding is held. Entries for physical addresses which don't
+   * hold a logical word are UINT32_MAX. Large transfers then walk the memory
+   * in physical address order, so that they fill whole blocks. By default,
+   * this returns nullptr and transfers walk logical addresses.
    */
-  void ReadToMinibuf(uint8_t *minibuf, uint32_t phys_addr) const;
+  virtual const std::vector<uint32_t> *GetLogicalAddrs() const {
+    return nullptr;
+  }
 
-  /** Write from minibuf to the memory word at phys_addr
+  /** Write \p num_words logical words, starting at \p word_offset, to the
+   * memory
+   *
+   * The words are transferred in blocks of up to SV_MEM_BLOCK_WORDS words
+   * with consecutive physical addresses, with one scope switch and one DPI
+   * call per block. Usually, blocks hold words with consecutive logical
+   * addresses. If GetLogicalAddrs() returns a table and the transfer is
+   * large, blocks are filled in physical address order instead, so the
+   * logical addresses of the words of a block can be in any order.
+   *
+   * @param word_offset The logical address of the first word to write
+   *
+   * @param num_words   The number of words to write
    *
-   * minibuf should be at least SV_MEM_WIDTH_BYTES in size. See the
-   * implementation of MemArea::Write() for the details.
+   * @param fill        Called once for each block, with the block buffer
+   *                    (SV_MEM_WIDTH_BYTES bytes for each word), the logical
+   *                    address of each word in the block and the number of
+   *                    words in the block. It must fill the buffer with the
+   *                    physical memory bits of the words, like
+   *                    WriteBufferBlock().
    */
-  void WriteFromMinibuf(uint32_t phys_addr, const uint8_t *minibuf,
-                        uint32_t dst_word) const;
+  void WriteWords(
+      uint32_t word_offset, uint32_t num_words,
+      const std::function<void(uint8_t *, const uint32_t *, uint32_t)> &fill)
+      const;
+
+  /** Read \p num_words logical words, starting at \p word_offset, from the
+   * memory
+   *
+   * This is the counterpart of WriteWords().
+   *
+   * @param word_offset The logical address of the first word to read
+   *
+   * @param num_words   The number of words to read
+   *
+   * @param extract     Called for each block with the block buffer holding
+   *                    the physical memory bits of the words, the logical
+   *                    address of each word in the block and the number of
+   *                    words in the block, like ReadBufferBlock().
+   */
+  void ReadWords(uint32_t word_offset, uint32_t num_words,
+                 const std::function<void(const uint8_t *, const uint32_t *,
+                                          uint32_t)> &extract) const;
+
+ private:
+  /** Split the transfer of \p num_words logical words, starting at \p
+   * word_offset, into blocks of words with consecutive physical addresses
+   *
+   * This calls \p block once for each block, with its first physical
+   * address, the logical address of each word and the number of words. See
+   * WriteWords() for the order of the words.
+   */
+  void ForEachBlock(
+      uint32_t word_offset, uint32_t num_words,
+      const std::function<void(uint32_t, const uint32_t *, uint32_t)> &block)
+      const;
+
+  /** Read num_words words with consecutive physical addresses, starting at
+   * phys_addr, into the block buffer buf.
+   */
+  void ReadBlock(uint8_t buf[SV_MEM_BLOCK_BYTES], uint32_t phys_addr,
+                 uint32_t num_words) const;
+
+  /** Write num_words words with consecutive physical addresses, starting at
+   * phys_addr, from the block buffer buf. dst_word is the logical address of
+   * the first word, used for error messages.
+   */
+  void WriteBlock(uint32_t phys_addr, const uint8_t buf[SV_MEM_BLOCK_BYTES],
+                  uint32_t num_words, uint32_t dst_word) const;
+};
+
+/**
+ * Holds the encoding parameters of a memory area (see MemArea::HoldEncoding())
+ * for as long as it exists, unless they are held already
+ *
+ * Transfers like MemArea::Write() and MemArea::Read() use this for their
+ * duration. Create one before a series of transfers to read the parameters
+ * from the design only once for all of them.
+ */
+class TransferHold {
+ public:
+  explicit TransferHold(const MemArea &mem_area)
+      : mem_area_(mem_area), held_(!mem_area.IsEncodingHeld()) {
+    if (held_) {
+      mem_area_.HoldEncoding();
+    }
+  }
+  ~TransferHold() {
+    if (held_) {
+      mem_area_.ReleaseEncoding();
+    }
+  }
+
+  TransferHold(const TransferHold &) = delete;
+  TransferHold &operator=(const TransferHold &) = delete;
+
+ private:
+  const MemArea &mem_area_;
+  bool held_;
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_CPP_MEM_AREA_H_
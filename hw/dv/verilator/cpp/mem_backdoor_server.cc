@@ -0,0 +1,338 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "mem_backdoor_server.h"
+
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ecc32_mem_area.h"
+#include "sv_scoped.h"
+#include "tcp_server.h"
+
+// If a client stops sending in the middle of a request, give up waiting for
+// the rest of it after this long and continue the simulation.
+static const std::chrono::milliseconds kRequestTimeout(1000);
+
+static const char kHexDigits[] = "0123456789abcdef";
+
+static int HexDigitValue(char c) {
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Parse an unsigned number in decimal or (with a 0x prefix) hex. Return true
+// on success.
+static bool ParseNumber(const std::string &text, uint32_t *val) {
+  if (text.empty() || !('0' <= text[0] && text[0] <= '9')) {
+    return false;
+  }
+  char *txt_end;
+  errno = 0;
+  unsigned long num = strtoul(text.c_str(), &txt_end, 0);
+  if (*txt_end || errno || num > UINT32_MAX) {
+    return false;
+  }
+  *val = num;
+  return true;
+}
+
+MemBackdoorServer::MemBackdoorServer(const DpiMemUtil *mem_util)
+    : mem_util_(mem_util), port_(0), server_(nullptr) {
+  assert(mem_util);
+}
+
+MemBackdoorServer::~MemBackdoorServer() {
+  if (server_) {
+    tcp_server_close(server_);
+  }
+}
+
+bool MemBackdoorServer::ParseCLIArguments(int argc, char **argv,
+                                          bool &exit_app) {
+  const struct option long_options[] = {
+      {"mem-backdoor-port", required_argument, nullptr, 'B'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, "-:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+      case 'B': {
+        uint32_t port;
+        if (!ParseNumber(optarg, &port) || port == 0 || port > 65535) {
+          std::cerr << "ERROR: Bad port for mem-backdoor-port argument: `"
+                    << optarg << "'." << std::endl;
+          return false;
+        }
+        port_ = port;
+        break;
+      }
+      case 'h':
+        std::cout << "Memory backdoor server:\n\n"
+                     "--mem-backdoor-port=PORT\n"
+                     "  Serve reads and writes of the registered memory\n"
+                     "  regions on TCP port PORT\n\n";
+        break;
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+    }
+  }
+  return true;
+}
+
+void MemBackdoorServer::PreExec() {
+  if (!port_) {
+    return;
+  }
+  server_ = tcp_server_create("mem_backdoor", port_);
+  if (server_) {
+    std::cout << std::endl
+              << "Memory backdoor: Listening on port " << port_ << "."
+              << std::endl;
+  }
+}
+
+void MemBackdoorServer::PostExec() {
+  if (server_) {
+    tcp_server_close(server_);
+    server_ = nullptr;
+  }
+}
+
+unsigned long MemBackdoorServer::GetClockDivider() const {
+  return port_ ? kPollCycles : 0;
+}
+
+unsigned long MemBackdoorServer::GetNextActiveCycle(unsigned long cycle) {
+  // Don't skip over more than one poll, so that requests are still served
+  // while the simulation is fast-forwarded.
+  return port_ ? cycle + kPollCycles : ULONG_MAX;
+}
+
+void MemBackdoorServer::OnClock(unsigned long sim_time) {
+  if (!server_) {
+    return;
+  }
+
+  // Once a request has started, wait for the rest of it: large pokes arrive
+  // in many chunks, and continuing the simulation in between would make
+  // them crawl.
+  auto last_data = std::chrono::steady_clock::now();
+  while (true) {
+    char c;
+    if (!tcp_server_read(server_, &c)) {
+      if (request_.empty() ||
+          std::chrono::steady_clock::now() - last_data > kRequestTimeout) {
+        return;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    last_data = std::chrono::steady_clock::now();
+
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      request_ += c;
+      continue;
+    }
+
+    std::string request;
+    request.swap(request_);
+    if (!request.empty()) {
+      SendResponse(HandleRequest(request));
+    }
+  }
+}
+
+std::string MemBackdoorServer::HandleRequest(
+    const std::string &request) const {
+  std::istringstream args(request);
+  std::string cmd;
+  args >> cmd;
+
+  try {
+    if (cmd == "list") {
+      return HandleList();
+    }
+    if (cmd == "peek") {
+      return HandlePeek(args);
+    }
+    if (cmd == "poke") {
+      return HandlePoke(args);
+    }
+  } catch (const SVScoped::Error &err) {
+    return "error No memory found at `" + err.scope_name_ + "'.";
+  } catch (const std::exception &err) {
+    return std::string("error ") + err.what();
+  }
+  return "error Unknown request `" + cmd + "'.";
+}
+
+std::string MemBackdoorServer::HandleList() const {
+  std::ostringstream oss;
+  for (const std::string &name : mem_util_->GetMemoryNames()) {
+    uint32_t base;
+    const MemArea *mem_area = mem_util_->FindMemoryArea(name, &base);
+    assert(mem_area);
+    bool ecc = dynamic_cast<const Ecc32MemArea *>(mem_area) != nullptr;
+    oss << "mem " << name << " 0x" << std::hex << base << " 0x"
+        << mem_area->GetSizeBytes() << std::dec << " "
+        << mem_area->GetWidthByte() << (ecc ? " ecc" : " plain") << "\n";
+  }
+  oss << "ok";
+  return oss.str();
+}
+
+std::string MemBackdoorServer::HandlePeek(std::istringstream &args) const {
+  std::string name, word_text, num_words_text, extra;
+  args >> name >> word_text >> num_words_text >> extra;
+  uint32_t word_offset, num_words;
+  if (num_words_text.empty() || !extra.empty() ||
+      !ParseNumber(word_text, &word_offset) ||
+      !ParseNumber(num_words_text, &num_words)) {
+    return "error Usage: peek NAME WORD NUM_WORDS";
+  }
+
+  const MemArea *mem_area = mem_util_->FindMemoryArea(name);
+  if (!mem_area) {
+    return "error Unknown memory region `" + name + "'.";
+  }
+  if (word_offset > mem_area->GetSizeWords() ||
+      num_words > mem_area->GetSizeWords() - word_offset) {
+    return "error Range is out of bounds.";
+  }
+
+  std::string response = "ok ";
+  auto ecc_area = dynamic_cast<const Ecc32MemArea *>(mem_area);
+  if (ecc_area) {
+    Ecc32MemArea::EccWords words =
+        ecc_area->ReadWithIntegrity(word_offset, num_words);
+    response.reserve(3 + 9 * words.size());
+    for (const Ecc32MemArea::EccWord &word : words) {
+      for (int i = 0; i < 4; ++i) {
+        uint8_t byte = word.second >> (8 * i);
+        response += kHexDigits[byte >> 4];
+        response += kHexDigits[byte & 0xf];
+      }
+    }
+    response += ' ';
+    for (const Ecc32MemArea::EccWord &word : words) {
+      response += word.first ? '1' : '0';
+    }
+  } else {
+    std::vector<uint8_t> data = mem_area->Read(word_offset, num_words);
+    response.reserve(3 + 2 * data.size());
+    for (uint8_t byte : data) {
+      response += kHexDigits[byte >> 4];
+      response += kHexDigits[byte & 0xf];
+    }
+  }
+  return response;
+}
+
+std::string MemBackdoorServer::HandlePoke(std::istringstream &args) const {
+  std::string name, word_text, hex, valid, extra;
+  args >> name >> word_text >> hex >> valid >> extra;
+  uint32_t word_offset;
+  if (hex.empty() || !extra.empty() || !ParseNumber(word_text, &word_offset)) {
+    return "error Usage: poke NAME WORD DATA [VALID]";
+  }
+
+  const MemArea *mem_area = mem_util_->FindMemoryArea(name);
+  if (!mem_area) {
+    return "error Unknown memory region `" + name + "'.";
+  }
+
+  std::vector<uint8_t> data(hex.size() / 2);
+  if (hex.size() % 2) {
+    return "error DATA must have two digits per byte.";
+  }
+  for (size_t i = 0; i < data.size(); ++i) {
+    int hi = HexDigitValue(hex[2 * i]), lo = HexDigitValue(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      return "error DATA must be hex digits.";
+    }
+    data[i] = (hi << 4) | lo;
+  }
+
+  uint32_t width_byte = mem_area->GetWidthByte();
+  uint32_t num_words = data.size() / width_byte;
+  if (data.size() % width_byte) {
+    return "error DATA must be a whole number of words.";
+  }
+  if (word_offset > mem_area->GetSizeWords() ||
+      num_words > mem_area->GetSizeWords() - word_offset) {
+    return "error Range is out of bounds.";
+  }
+
+  auto ecc_area = dynamic_cast<const Ecc32MemArea *>(mem_area);
+  if (!valid.empty() && !ecc_area) {
+    return "error VALID is only supported for memories with ECC bits.";
+  }
+  if (!valid.empty() && valid.size() != data.size() / 4) {
+    return "error VALID must have one digit per 32-bit word.";
+  }
+
+  Ecc32MemArea::EccWords words;
+  words.reserve(valid.size());
+  for (size_t i = 0; i < valid.size(); ++i) {
+    if (valid[i] != '0' && valid[i] != '1') {
+      return "error VALID must be a string of 0s and 1s.";
+    }
+    uint32_t word = 0;
+    for (int j = 0; j < 4; ++j) {
+      word |= (uint32_t)data[4 * i + j] << (8 * j);
+    }
+    words.emplace_back(valid[i] == '1', word);
+  }
+
+  if (!words.empty()) {
+    ecc_area->WriteWithIntegrity(word_offset, words);
+  } else {
+    mem_area->Write(word_offset, data);
+  }
+  return "ok";
+}
+
+void MemBackdoorServer::SendResponse(const std::string &response) {
+  std::string line = response + '\n';
+  // Responses to peeks can be larger than the buffer of the server, so wait
+  // for it to drain. If the client goes away, the rest is discarded.
+  size_t sent = 0;
+  while (sent < line.size()) {
+    size_t num_written =
+        tcp_server_write_bulk(server_, &line[sent], line.size() - sent);
+    if (num_written == 0) {
+      std::this_thread::yield();
+    }
+    sent += num_written;
+  }
+}
@@ -0,0 +1,101 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+#ifndef OPENTITAN_HW_DV_VERILATOR_CPP_MEM_BACKDOOR_SERVER_H_
+#define OPENTITAN_HW_DV_VERILATOR_CPP_MEM_BACKDOOR_SERVER_H_
+
+#include <sstream>
+#include <string>
+
+#include "dpi_memutil.h"
+#include "sim_ctrl_extension.h"
+
+struct tcp_server_ctx;
+
+/**
+ * Backdoor access to the memories of a running simulation over TCP
+ *
+ * With --mem-backdoor-port=PORT, this extension listens on PORT (using the
+ * TCP server of the DPI models) and serves requests to read ("peek") and
+ * write ("poke") the memory regions registered with a DpiMemUtil, while the
+ * simulation is running. Host tools can use it to inspect or patch whole
+ * ranges of RAM or flash much faster than through JTAG.
+ *
+ * Requests and responses are lines of text. Numbers can be given in decimal
+ * or, with a 0x prefix, in hex. Data is given as hex digits, two for each
+ * byte, in the order of the bytes in memory.
+ *
+ *   list
+ *     One line "mem NAME BASE SIZE WIDTH KIND" per memory region, where BASE
+ *     is its LMA, SIZE its size in bytes, WIDTH the width of a word in bytes
+ *     and KIND "ecc" for memories with ECC bits and "plain" otherwise.
+ *     Followed by "ok".
+ *
+ *   peek NAME WORD NUM_WORDS
+ *     Read NUM_WORDS words, starting at word WORD, of memory region NAME.
+ *     Responds with "ok DATA", or "ok DATA VALID" for memories with ECC bits.
+ *     VALID has a '1' for each 32-bit word with valid integrity bits and a
+ *     '0' for each word without.
+ *
+ *   poke NAME WORD DATA [VALID]
+ *     Write DATA, which must be a whole number of words, to memory region
+ *     NAME, starting at word WORD. For memories with ECC bits, VALID can give
+ *     the validity of the integrity bits of each 32-bit word like for peek,
+ *     e.g. to inject errors. It defaults to all valid. Responds with "ok".
+ *
+ * Data is encoded and decoded like for any other access through MemArea, so
+ * peek and poke see the logical contents of memories with ECC bits or
+ * scrambling. Failed requests get a response of "error MESSAGE".
+ *
+ * Requests are handled in OnClock(), between clock cycles, every
+ * kPollCycles cycles.
+ */
+class MemBackdoorServer : public SimCtrlExtension {
+ public:
+  /**
+   * Serve the memories registered with mem_util, which must outlive this
+   * object (but isn't owned by it)
+   */
+  explicit MemBackdoorServer(const DpiMemUtil *mem_util);
+  ~MemBackdoorServer();
+
+  MemBackdoorServer(const MemBackdoorServer &) = delete;
+  MemBackdoorServer &operator=(const MemBackdoorServer &) = delete;
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void PreExec() override;
+  void OnClock(unsigned long sim_time) override;
+  unsigned long GetClockDivider() const override;
+  unsigned long GetNextActiveCycle(unsigned long cycle) override;
+  void PostExec() override;
+
+  // Number of clock cycles between two polls for requests
+  static const unsigned long kPollCycles = 256;
+
+ private:
+  const DpiMemUtil *mem_util_;
+  int port_;
+  struct tcp_server_ctx *server_;
+  // The part of the current request line received so far
+  std::string request_;
+
+  /**
+   * Handle a request line and return the response (without newline)
+   */
+  std::string HandleRequest(const std::string &request) const;
+
+  /**
+   * Handle the individual requests, see the class description
+   */
+  std::string HandleList() const;
+  std::string HandlePeek(std::istringstream &args) const;
+  std::string HandlePoke(std::istringstream &args) const;
+
+  /**
+   * Send a response line to the client
+   */
+  void SendResponse(const std::string &response);
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_CPP_MEM_BACKDOOR_SERVER_H_
@@ -0,0 +1,284 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "mem_dump.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <elf.h>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include "vmem_parser.h"
+
+namespace {
+// Convenience class for runtime errors when reading or writing a dump
+class DumpError : public std::runtime_error {
+ public:
+  DumpError(const std::string &path, const std::string &msg)
+      : std::runtime_error("Memory dump `" + path + "': " + msg) {}
+};
+}  // namespace
+
+// Number of words on each line of a vmem dump
+static const uint32_t kVmemWordsPerLine = 8;
+
+static void WriteElfDump(std::ostream &os, const MemDump &dump) {
+  Elf32_Ehdr ehdr;
+  memset(&ehdr, 0, sizeof ehdr);
+  memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+  ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+  ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  ehdr.e_type = ET_EXEC;
+  ehdr.e_machine = EM_RISCV;
+  ehdr.e_version = EV_CURRENT;
+  ehdr.e_entry = dump.base;
+  ehdr.e_phoff = sizeof ehdr;
+  ehdr.e_ehsize = sizeof ehdr;
+  ehdr.e_phentsize = sizeof(Elf32_Phdr);
+  ehdr.e_phnum = 1;
+
+  Elf32_Phdr phdr;
+  memset(&phdr, 0, sizeof phdr);
+  phdr.p_type = PT_LOAD;
+  phdr.p_offset = sizeof ehdr + sizeof phdr;
+  phdr.p_vaddr = dump.base;
+  phdr.p_paddr = dump.base;
+  phdr.p_filesz = dump.data.size();
+  phdr.p_memsz = dump.data.size();
+  phdr.p_flags = PF_R | PF_W;
+  phdr.p_align = 4;
+
+  os.write(reinterpret_cast<const char *>(&ehdr), sizeof ehdr);
+  os.write(reinterpret_cast<const char *>(&phdr), sizeof phdr);
+  os.write(reinterpret_cast<const char *>(dump.data.data()), dump.data.size());
+}
+
+static void WriteVmemDump(std::ostream &os, const MemDump &dump) {
+  uint32_t width_byte = dump.width_byte;
+  assert(width_byte > 0);
+  uint32_t num_words = (dump.data.size() + width_byte - 1) / width_byte;
+
+  // Format into a string first: formatting every digit on the stream is much
+  // slower.
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string line;
+  for (uint32_t word = 0; word < num_words; word += kVmemWordsPerLine) {
+    std::ostringstream addr;
+    addr << "@" << std::hex << std::setfill('0') << std::setw(8) << word;
+    line = addr.str();
+
+    uint32_t line_end = std::min(num_words, word + kVmemWordsPerLine);
+    for (uint32_t i = word; i < line_end; ++i) {
+      line += ' ';
+      // Words are little-endian in memory, but vmem files give the most
+      // significant digit first.
+      for (uint32_t j = width_byte; j-- > 0;) {
+        size_t idx = (size_t)i * width_byte + j;
+        uint8_t byte = idx < dump.data.size() ? dump.data[idx] : 0;
+        line += kHexDigits[byte >> 4];
+        line += kHexDigits[byte & 0xf];
+      }
+    }
+    line += '\n';
+    os.write(line.data(), line.size());
+  }
+}
+
+void WriteMemDump(const std::string &path, MemImageType type,
+                  const MemDump &dump) {
+  std::ofstream os(path, std::ios::binary);
+  if (!os) {
+    throw DumpError(path, "could not open file for writing.");
+  }
+
+  switch (type) {
+    case kMemImageElf:
+      WriteElfDump(os, dump);
+      break;
+    case kMemImageVmem:
+      WriteVmemDump(os, dump);
+      break;
+    case kMemImageRaw:
+      os.write(reinterpret_cast<const char *>(dump.data.data()),
+               dump.data.size());
+      break;
+    default:
+      assert(0);
+  }
+
+  os.close();
+  if (!os) {
+    throw DumpError(path, "failed to write file.");
+  }
+}
+
+static MemDump ReadElfDump(const std::string &path,
+                           const std::vector<uint8_t> &file) {
+  Elf32_Ehdr ehdr;
+  if (file.size() < sizeof ehdr) {
+    throw DumpError(path, "file is too short to be an ELF file.");
+  }
+  memcpy(&ehdr, file.data(), sizeof ehdr);
+  if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0) {
+    throw DumpError(path, "not an ELF file.");
+  }
+  if (ehdr.e_ident[EI_CLASS] != ELFCLASS32 ||
+      ehdr.e_ident[EI_DATA] != ELFDATA2LSB) {
+    throw DumpError(path, "not a little-endian 32-bit ELF file.");
+  }
+  if (ehdr.e_phentsize != sizeof(Elf32_Phdr) ||
+      ehdr.e_phoff + (size_t)ehdr.e_phnum * sizeof(Elf32_Phdr) >
+          file.size()) {
+    throw DumpError(path, "invalid program header table.");
+  }
+
+  std::vector<Elf32_Phdr> loads;
+  for (unsigned i = 0; i < ehdr.e_phnum; ++i) {
+    Elf32_Phdr phdr;
+    memcpy(&phdr, &file[ehdr.e_phoff + i * sizeof phdr], sizeof phdr);
+    if (phdr.p_type != PT_LOAD) {
+      continue;
+    }
+    // The segment must fit into the file and, once placed at its LMA, into
+    // the 32-bit address space.
+    if (phdr.p_memsz == 0 || phdr.p_filesz > phdr.p_memsz ||
+        (size_t)phdr.p_offset + phdr.p_filesz > file.size() ||
+        phdr.p_memsz - 1 > ~(uint32_t)0 - phdr.p_paddr) {
+      std::ostringstream oss;
+      oss << "segment " << i << " is out of bounds.";
+      throw DumpError(path, oss.str());
+    }
+    loads.push_back(phdr);
+  }
+
+  MemDump dump = {0, 1, {}};
+  if (loads.empty()) {
+    return dump;
+  }
+
+  // Place all segments by LMA, relative to the lowest one
+  uint32_t lo = ~(uint32_t)0, top = 0;
+  for (const Elf32_Phdr &phdr : loads) {
+    lo = std::min(lo, phdr.p_paddr);
+    top = std::max(top, phdr.p_paddr + (phdr.p_memsz - 1));
+  }
+  dump.base = lo;
+  dump.data.resize((size_t)(top - lo) + 1, 0);
+  for (const Elf32_Phdr &phdr : loads) {
+    memcpy(&dump.data[phdr.p_paddr - lo], &file[phdr.p_offset],
+           phdr.p_filesz);
+  }
+  return dump;
+}
+
+static MemDump ReadVmemDump(const std::string &path) {
+  // Widest word supported in a vmem dump
+  const uint32_t kMaxWordBytes = 64;
+
+  MemDump dump = {0, 0, {}};
+  VmemParser parser(path, kMaxWordBytes);
+  uint8_t word[kMaxWordBytes];
+  uint32_t addr, num_digits;
+  while (parser.Next(&addr, word, &num_digits)) {
+    // The first word defines the word width
+    if (!dump.width_byte) {
+      dump.width_byte = std::min((num_digits + 1) / 2, kMaxWordBytes);
+    }
+    uint32_t width_byte = dump.width_byte;
+    for (uint32_t i = width_byte; i < kMaxWordBytes; ++i) {
+      if (word[i]) {
+        parser.Error("word is wider than the first word.");
+      }
+    }
+    if ((addr + (uint64_t)1) * width_byte > 0x100000000ull) {
+      parser.Error("word address is out of range.");
+    }
+
+    size_t offset = (size_t)addr * width_byte;
+    if (dump.data.size() < offset + width_byte) {
+      dump.data.resize(offset + width_byte, 0);
+    }
+    memcpy(&dump.data[offset], word, width_byte);
+  }
+
+  if (!dump.width_byte) {
+    dump.width_byte = 1;
+  }
+  return dump;
+}
+
+MemDump ReadMemDump(const std::string &path, MemImageType type) {
+  // Vmem files are parsed as they are read
+  if (type == kMemImageVmem) {
+    return ReadVmemDump(path);
+  }
+
+  std::ifstream is(path, std::ios::binary);
+  if (!is) {
+    throw DumpError(path, "could not open file.");
+  }
+  std::vector<uint8_t> file((std::istreambuf_iterator<char>(is)),
+                            std::istreambuf_iterator<char>());
+  if (is.bad()) {
+    throw DumpError(path, "failed to read file.");
+  }
+
+  switch (type) {
+    case kMemImageElf:
+      return ReadElfDump(path, file);
+    case kMemImageRaw: {
+      MemDump dump = {0, 1, {}};
+      dump.data.swap(file);
+      return dump;
+    }
+    default:
+      assert(0);
+      return MemDump();
+  }
+}
+
+std::vector<AddrRange<uint32_t>> DiffMemDumps(const MemDump &a,
+                                              const MemDump &b) {
+  std::vector<AddrRange<uint32_t>> ret;
+  const uint8_t *a_data = a.data.data();
+  const uint8_t *b_data = b.data.data();
+  size_t common = std::min(a.data.size(), b.data.size());
+
+  // Skip identical data in chunks, which is much faster than comparing single
+  // bytes. Dumps of mostly unchanged memories are mostly skipped like this.
+  const size_t kChunk = 64;
+  size_t i = 0;
+  while (i < common) {
+    if (i + kChunk <= common && !memcmp(a_data + i, b_data + i, kChunk)) {
+      i += kChunk;
+      continue;
+    }
+    if (a_data[i] == b_data[i]) {
+      ++i;
+      continue;
+    }
+
+    size_t lo = i;
+    while (i < common && a_data[i] != b_data[i]) {
+      ++i;
+    }
+    ret.push_back({(uint32_t)lo, (uint32_t)(i - 1)});
+  }
+
+  size_t longest = std::max(a.data.size(), b.data.size());
+  if (common < longest) {
+    if (!ret.empty() && ret.back().hi + (size_t)1 == common) {
+      ret.back().hi = longest - 1;
+    } else {
+      ret.push_back({(uint32_t)common, (uint32_t)(longest - 1)});
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,72 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_CPP_MEM_DUMP_H_
+#define OPENTITAN_HW_DV_VERILATOR_CPP_MEM_DUMP_H_
+
+//
+// Reading, writing and comparing snapshots of memory contents
+//
+// This doesn't depend on the simulation, so that tools working on dumps after
+// the fact (like memdump_diff) can use it too.
+//
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ranged_map.h"
+
+enum MemImageType {
+  kMemImageUnknown = 0,
+  kMemImageElf,
+  kMemImageVmem,
+  kMemImageRaw,
+};
+
+// The logical contents of a memory at some point in time
+struct MemDump {
+  // Address of the first byte of data. This is the LMA of the memory for ELF
+  // files and 0 for other formats.
+  uint32_t base;
+  // Width of a memory word in bytes
+  uint32_t width_byte;
+  std::vector<uint8_t> data;
+};
+
+/**
+ * Write |dump| to the file at |path| in the format given by |type|
+ *
+ * ELF files get a single loadable segment at dump.base. Vmem files have one
+ * line per 8 words, each starting with the word address. Raw files just
+ * contain the bytes of data.
+ *
+ * Raises a std::runtime_error if the file can't be written.
+ */
+void WriteMemDump(const std::string &path, MemImageType type,
+                  const MemDump &dump);
+
+/**
+ * Read a dump in the format given by |type| from the file at |path|
+ *
+ * This reads the files written by WriteMemDump(), but also other ELF files
+ * (placing all loadable segments relative to the lowest one) and vmem files.
+ * The word width of a vmem file is taken from the number of digits of its
+ * first word, that of an ELF or raw file is 1.
+ *
+ * Raises a std::runtime_error if the file can't be read or parsed.
+ */
+MemDump ReadMemDump(const std::string &path, MemImageType type);
+
+/**
+ * Get the byte ranges in which |a| and |b| differ
+ *
+ * The dumps are compared byte by byte from their start, and ranges are given
+ * as offsets from there. If one dump is longer than the other, its extra
+ * bytes count as changed.
+ */
+std::vector<AddrRange<uint32_t>> DiffMemDumps(const MemDump &a,
+                                              const MemDump &b);
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_CPP_MEM_DUMP_H_
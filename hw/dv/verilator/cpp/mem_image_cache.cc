@@ -0,0 +1,166 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "mem_image_cache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+// Identifies cache entries, and their format version
+static const char kEntryMagic[8] = {'O', 'T', 'M', 'E', 'M', 'I', 'M', '2'};
+
+// FNV-1a hash of |size| bytes at |data|, continuing from |hash|
+static uint64_t Fnv1a(uint64_t hash, const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void MemImageCache::Write(const MemArea &mem_area, uint32_t word_offset,
+                          const uint8_t *data, size_t size) const {
+  if (mem_area.GetEncodingId().empty()) {
+    mem_area.Write(word_offset, data, size);
+    return;
+  }
+
+  uint32_t width_byte = mem_area.GetWidthByte();
+  uint32_t num_words = (size + width_byte - 1) / width_byte;
+  Entry entry = GetEntry(mem_area, word_offset, data, size);
+
+  MemArea::PhysImage image;
+  if (!Load(entry, data, size, num_words, &image) ||
+      image.word_offset != word_offset) {
+    image = mem_area.Encode(word_offset, data, size);
+    Store(entry, data, size, image);
+  }
+  mem_area.WritePhys(image);
+}
+
+MemImageCache::Entry MemImageCache::GetEntry(const MemArea &mem_area,
+                                             uint32_t word_offset,
+                                             const uint8_t *data,
+                                             size_t size) const {
+  // Everything which affects the encoded image goes into the key
+  std::ostringstream params;
+  params << mem_area.GetScope() << '\n'
+         << mem_area.GetSizeWords() << ',' << mem_area.GetWidthByte() << '\n'
+         << mem_area.GetEncodingId() << '\n'
+         << word_offset << ',' << size << '\n';
+
+  Entry entry;
+  entry.params = params.str();
+  entry.mem_size_words = mem_area.GetSizeWords();
+
+  // Two FNV-1a hashes with different offset bases make accidental collisions
+  // between 128-bit names very unlikely. They aren't collision-resistant
+  // though, so Load() compares the full key.
+  uint64_t hashes[2] = {0xcbf29ce484222325ull, 0x84222325cbf29ce4ull};
+  for (uint64_t &hash : hashes) {
+    hash = Fnv1a(hash, entry.params.data(), entry.params.size());
+    hash = Fnv1a(hash, data, size);
+  }
+
+  std::ostringstream path;
+  path << dir_ << "/" << std::hex << std::setfill('0') << std::setw(16)
+       << hashes[0] << std::setw(16) << hashes[1] << ".memimg";
+  entry.path = path.str();
+  return entry;
+}
+
+bool MemImageCache::Load(const Entry &entry, const uint8_t *data, size_t size,
+                         uint32_t num_words, MemArea::PhysImage *image) {
+  std::ifstream file(entry.path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  // The header is followed by the key (the parameters and the data) and the
+  // image.
+  char magic[sizeof kEntryMagic];
+  uint32_t header[4];
+  file.read(magic, sizeof magic);
+  file.read(reinterpret_cast<char *>(header), sizeof header);
+  if (!file || memcmp(magic, kEntryMagic, sizeof magic) ||
+      header[1] != num_words || header[2] != entry.params.size() ||
+      header[3] != size) {
+    return false;
+  }
+
+  // Different keys can have the same file name
+  std::string params(entry.params.size(), '\0');
+  file.read(&params[0], params.size());
+  if (!file || params != entry.params) {
+    return false;
+  }
+  std::vector<uint8_t> key_data(size);
+  file.read(reinterpret_cast<char *>(key_data.data()), key_data.size());
+  if (!file || (size && memcmp(key_data.data(), data, size))) {
+    return false;
+  }
+
+  image->word_offset = header[0];
+  image->phys_addrs.resize(num_words);
+  image->bits.resize((size_t)num_words * SV_MEM_WIDTH_BYTES);
+  file.read(reinterpret_cast<char *>(image->phys_addrs.data()),
+            image->phys_addrs.size() * sizeof(uint32_t));
+  file.read(reinterpret_cast<char *>(image->bits.data()), image->bits.size());
+  if (!file) {
+    return false;
+  }
+
+  // Never write outside of the memory, whatever the file says
+  for (uint32_t phys_addr : image->phys_addrs) {
+    if (phys_addr >= entry.mem_size_words) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MemImageCache::Store(const Entry &entry, const uint8_t *data,
+                          size_t size, const MemArea::PhysImage &image) {
+  const std::string &path = entry.path;
+
+  // Write to a private file first, so that other simulations never see a
+  // partially written entry. Entries can be stored from several threads, so
+  // the name must be unique within this process too.
+  static std::atomic<unsigned> tmp_counter(0);
+  std::string tmp_path = path + ".tmp." + std::to_string(getpid()) + "." +
+                         std::to_string(tmp_counter++);
+  uint32_t header[4] = {image.word_offset, (uint32_t)image.phys_addrs.size(),
+                        (uint32_t)entry.params.size(), (uint32_t)size};
+  {
+    std::ofstream file(tmp_path, std::ios::binary);
+    file.write(kEntryMagic, sizeof kEntryMagic);
+    file.write(reinterpret_cast<const char *>(header), sizeof header);
+    file.write(entry.params.data(), entry.params.size());
+    file.write(reinterpret_cast<const char *>(data), size);
+    file.write(reinterpret_cast<const char *>(image.phys_addrs.data()),
+               image.phys_addrs.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(image.bits.data()),
+               image.bits.size());
+    if (!file) {
+      std::cerr << "WARNING: Unable to write memory image cache entry `"
+                << tmp_path << "'." << std::endl;
+      unlink(tmp_path.c_str());
+      return;
+    }
+  }
+
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::cerr << "WARNING: Unable to add `" << path
+              << "' to the memory image cache." << std::endl;
+    unlink(tmp_path.c_str());
+  }
+}
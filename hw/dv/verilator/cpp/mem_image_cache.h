@@ -0,0 +1,90 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_CPP_MEM_IMAGE_CACHE_H_
+#define OPENTITAN_HW_DV_VERILATOR_CPP_MEM_IMAGE_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "mem_area.h"
+
+/**
+ * An on-disk cache of encoded memory images
+ *
+ * Encoding data for memories with ECC bits or scrambling is expensive, and
+ * the same images tend to be loaded over and over again. This cache stores
+ * the physical images, as returned by MemArea::Encode(), in a directory. An
+ * entry is identified by the data, the location it is written to, the
+ * geometry of the memory and its encoding (including scrambling key and
+ * nonce), so a cached image is only used where it would be encoded the same
+ * way. The file name of an entry is a hash of all of these, and the entry
+ * stores them in full, so that a hash collision can't return the image of
+ * other data.
+ *
+ * The directory can be shared between simulations running in parallel:
+ * entries are written to a temporary file and renamed into place.
+ */
+class MemImageCache {
+ public:
+  /**
+   * Create a cache in the directory at |dir|, which must exist
+   */
+  explicit MemImageCache(const std::string &dir) : dir_(dir) {}
+
+  /**
+   * Write |size| bytes at |data| to |mem_area|, starting at |word_offset|
+   *
+   * This is equivalent to MemArea::Write(), but takes the encoded image from
+   * the cache if possible, and adds it to the cache otherwise. Memories
+   * without an encoding (see MemArea::GetEncodingId()) are written directly.
+   * Errors accessing the cache are reported as warnings and never fail the
+   * write.
+   */
+  void Write(const MemArea &mem_area, uint32_t word_offset,
+             const uint8_t *data, size_t size) const;
+
+  /**
+   * Identifies the cache entry of a write, see GetEntry()
+   */
+  struct Entry {
+    std::string path;
+    // Everything apart from the data which affects the encoded image
+    std::string params;
+    // Size of the memory in words, which bounds the physical addresses
+    uint32_t mem_size_words;
+  };
+
+  /**
+   * Get the cache entry for the given write
+   *
+   * This reads the encoding parameters of |mem_area|, so it must be called
+   * from the simulation thread.
+   */
+  Entry GetEntry(const MemArea &mem_area, uint32_t word_offset,
+                 const uint8_t *data, size_t size) const;
+
+  /**
+   * Read the image of the |size| bytes at |data| from |entry| into |image|
+   *
+   * @return true if |entry| exists and holds a valid image of the data with
+   *         |num_words| words
+   */
+  static bool Load(const Entry &entry, const uint8_t *data, size_t size,
+                   uint32_t num_words, MemArea::PhysImage *image);
+
+  /**
+   * Store |image|, the image of the |size| bytes at |data|, in |entry|
+   *
+   * Load() and Store() don't access the simulation, so they can be called
+   * from any thread.
+   */
+  static void Store(const Entry &entry, const uint8_t *data, size_t size,
+                    const MemArea::PhysImage &image);
+
+ private:
+  std::string dir_;
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_CPP_MEM_IMAGE_CACHE_H_
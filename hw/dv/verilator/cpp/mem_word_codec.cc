@@ -0,0 +1,188 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "mem_word_codec.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#include "mem_area.h"
+#include "secded_enc.h"
+
+// Read and write a little-endian 32-bit value. Compilers turn these into
+// single loads and stores on little-endian hosts.
+static uint32_t LoadLe32(const uint8_t *bytes) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void StoreLe32(uint8_t *bytes, uint32_t val) {
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = val >> (8 * i);
+  }
+}
+
+// The implementations below are templated on the word width. A width of 0
+// means that the width is only known at runtime and passed as an argument;
+// otherwise the argument is ignored and the compiler can unroll the inner
+// loops and replace memcpy calls with plain loads and stores.
+
+template <uint32_t kWidthByte>
+static void PackPlain(uint8_t *block, const uint8_t *data, uint32_t width_byte,
+                      uint32_t num_words) {
+  const uint32_t width = kWidthByte ? kWidthByte : width_byte;
+  for (uint32_t i = 0; i < num_words; ++i) {
+    memcpy(block + (size_t)i * SV_MEM_WIDTH_BYTES, data + (size_t)i * width,
+           width);
+  }
+}
+
+template <uint32_t kWidthByte>
+static void UnpackPlain(uint8_t *data, const uint8_t *block,
+                        uint32_t width_byte, uint32_t num_words) {
+  const uint32_t width = kWidthByte ? kWidthByte : width_byte;
+  for (uint32_t i = 0; i < num_words; ++i) {
+    memcpy(data + (size_t)i * width, block + (size_t)i * SV_MEM_WIDTH_BYTES,
+           width);
+  }
+}
+
+// The 39-bit words are packed through a 64-bit accumulator, from which
+// complete bytes are stored. The accumulator holds fewer than 8 bits when a
+// word is added, so a 39-bit word always fits.
+template <uint32_t kWidth32>
+static void PackEcc32(uint8_t *block, const uint8_t *data,
+                      const uint8_t *check_bits, uint32_t width_32,
+                      uint32_t num_words) {
+  const uint32_t w32 = kWidth32 ? kWidth32 : width_32;
+  for (uint32_t i = 0; i < num_words; ++i) {
+    uint8_t *dst = block + (size_t)i * SV_MEM_WIDTH_BYTES;
+    const uint8_t *src = data + (size_t)i * 4 * w32;
+
+    uint64_t acc = 0;
+    unsigned acc_bits = 0;
+    for (uint32_t j = 0; j < w32; ++j) {
+      const uint8_t *bytes = src + 4 * j;
+      uint64_t check = check_bits[(size_t)i * w32 + j];
+      acc |= (LoadLe32(bytes) | ((check & 0x7f) << 32)) << acc_bits;
+      acc_bits += 39;
+      while (acc_bits >= 8) {
+        *dst++ = acc;
+        acc >>= 8;
+        acc_bits -= 8;
+      }
+    }
+    if (acc_bits) {
+      *dst = acc;
+    }
+  }
+}
+
+template <uint32_t kWidth32>
+static void UnpackEcc32(uint8_t *data, uint8_t *check_bits,
+                        const uint8_t *block, uint32_t width_32,
+                        uint32_t num_words) {
+  const uint32_t w32 = kWidth32 ? kWidth32 : width_32;
+  for (uint32_t i = 0; i < num_words; ++i) {
+    const uint8_t *src = block + (size_t)i * SV_MEM_WIDTH_BYTES;
+    uint8_t *dst = data + (size_t)i * 4 * w32;
+
+    uint64_t acc = 0;
+    unsigned acc_bits = 0;
+    for (uint32_t j = 0; j < w32; ++j) {
+      while (acc_bits < 39) {
+        acc |= (uint64_t)*src++ << acc_bits;
+        acc_bits += 8;
+      }
+      StoreLe32(dst + 4 * j, acc);
+      if (check_bits) {
+        check_bits[(size_t)i * w32 + j] = (acc >> 32) & 0x7f;
+      }
+      acc >>= 39;
+      acc_bits -= 39;
+    }
+  }
+}
+
+void PackPlainWords(uint8_t *block, const uint8_t *data, uint32_t width_byte,
+                    uint32_t num_words) {
+  assert(width_byte <= SV_MEM_WIDTH_BYTES);
+  switch (width_byte) {
+    case 4:
+      PackPlain<4>(block, data, width_byte, num_words);
+      break;
+    case 8:
+      PackPlain<8>(block, data, width_byte, num_words);
+      break;
+    default:
+      PackPlain<0>(block, data, width_byte, num_words);
+  }
+}
+
+void UnpackPlainWords(uint8_t *data, const uint8_t *block, uint32_t width_byte,
+                      uint32_t num_words) {
+  assert(width_byte <= SV_MEM_WIDTH_BYTES);
+  switch (width_byte) {
+    case 4:
+      UnpackPlain<4>(data, block, width_byte, num_words);
+      break;
+    case 8:
+      UnpackPlain<8>(data, block, width_byte, num_words);
+      break;
+    default:
+      UnpackPlain<0>(data, block, width_byte, num_words);
+  }
+}
+
+static void PackEcc32Checked(uint8_t *block, const uint8_t *data,
+                             const uint8_t *check_bits, uint32_t width_32,
+                             uint32_t num_words) {
+  switch (width_32) {
+    case 1:
+      PackEcc32<1>(block, data, check_bits, width_32, num_words);
+      break;
+    case 2:
+      PackEcc32<2>(block, data, check_bits, width_32, num_words);
+      break;
+    default:
+      PackEcc32<0>(block, data, check_bits, width_32, num_words);
+  }
+}
+
+void PackEcc32Words(uint8_t *block, const uint8_t *data,
+                    const uint8_t *check_bits, uint32_t width_32,
+                    uint32_t num_words) {
+  assert(39 * width_32 <= SV_MEM_WIDTH_BITS);
+  if (check_bits) {
+    PackEcc32Checked(block, data, check_bits, width_32, num_words);
+    return;
+  }
+
+  // Compute the check bits of a block of words at a time
+  uint8_t block_check_bits[SV_MEM_BLOCK_WORDS * (SV_MEM_WIDTH_BITS / 39)];
+  for (uint32_t i = 0; i < num_words; i += SV_MEM_BLOCK_WORDS) {
+    uint32_t n = num_words - i < SV_MEM_BLOCK_WORDS ? num_words - i
+                                                    : SV_MEM_BLOCK_WORDS;
+    const uint8_t *src = data + (size_t)i * 4 * width_32;
+    enc_secded_inv_39_32_buf(src, block_check_bits, (size_t)n * width_32);
+    PackEcc32Checked(block + (size_t)i * SV_MEM_WIDTH_BYTES, src,
+                     block_check_bits, width_32, n);
+  }
+}
+
+void UnpackEcc32Words(uint8_t *data, uint8_t *check_bits, const uint8_t *block,
+                      uint32_t width_32, uint32_t num_words) {
+  assert(39 * width_32 <= SV_MEM_WIDTH_BITS);
+  switch (width_32) {
+    case 1:
+      UnpackEcc32<1>(data, check_bits, block, width_32, num_words);
+      break;
+    case 2:
+      UnpackEcc32<2>(data, check_bits, block, width_32, num_words);
+      break;
+    default:
+      UnpackEcc32<0>(data, check_bits, block, width_32, num_words);
+  }
+}
@@ -0,0 +1,68 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_CPP_MEM_WORD_CODEC_H_
+#define OPENTITAN_HW_DV_VERILATOR_CPP_MEM_WORD_CODEC_H_
+
+// Conversions between logical memory words and the physical memory bits
+// passed to SystemVerilog, for whole blocks of words at once.
+//
+// A block holds the physical bits of each word in a slot of
+// SV_MEM_WIDTH_BYTES bytes (see mem_area.h), least significant byte first.
+// Logical data is a packed array of words of the logical width. The common
+// word widths (32-bit and 64-bit words, and one or two 32-bit words with ECC
+// bits) have specialised implementations, which move whole words rather
+// than single bytes or bits.
+//
+// These functions don't access the simulation, so they can also be used on
+// other threads and in benchmarks.
+
+#include <cstdint>
+
+/**
+ * Copy num_words words of width_byte bytes from data to the slots of block
+ *
+ * This writes the first width_byte bytes of each slot. The rest of each
+ * slot is left unchanged.
+ */
+void PackPlainWords(uint8_t *block, const uint8_t *data, uint32_t width_byte,
+                    uint32_t num_words);
+
+/**
+ * Copy num_words words of width_byte bytes from the slots of block to data
+ */
+void UnpackPlainWords(uint8_t *data, const uint8_t *block, uint32_t width_byte,
+                      uint32_t num_words);
+
+/**
+ * Encode num_words words of 4 * width_32 bytes from data, adding ECC bits,
+ * into the slots of block
+ *
+ * Each 32-bit word is stored as 39 bits: the 32 data bits, followed by the 7
+ * check bits of the inverted 39/32 SECDED code. A memory word with width_32
+ * 32-bit words takes 39 * width_32 bits.
+ *
+ * If check_bits is not null, it gives the check bits to use for each 32-bit
+ * word (e.g. to inject errors) rather than computing them.
+ *
+ * This writes the first (39 * width_32 + 7) / 8 bytes of each slot, with
+ * the bits above the last word cleared. The rest of each slot is left
+ * unchanged.
+ */
+void PackEcc32Words(uint8_t *block, const uint8_t *data,
+                    const uint8_t *check_bits, uint32_t width_32,
+                    uint32_t num_words);
+
+/**
+ * Decode num_words words with ECC bits from the slots of block, the inverse
+ * of PackEcc32Words()
+ *
+ * This writes the data bits to data. If check_bits is not null, it also
+ * writes the stored check bits of each 32-bit word there, so that the caller
+ * can check them.
+ */
+void UnpackEcc32Words(uint8_t *data, uint8_t *check_bits, const uint8_t *block,
+                      uint32_t width_32, uint32_t num_words);
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_CPP_MEM_WORD_CODEC_H_
@@ -0,0 +1,121 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Compare two memory dumps, as written with --memdump, and print the address
+// ranges in which they differ.
+//
+// Run with
+//   bazel run //hw/dv:memdump_diff -- [--type=TYPE] A B
+//
+// Like cmp, this exits with status 0 if the dumps are identical, 1 if they
+// differ and 2 if something went wrong.
+
+#include <cstring>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "mem_dump.h"
+
+// Return the type of the dump at path, from the name given with --type or
+// the file extension.
+static MemImageType GetDumpType(const std::string &path, const char *type) {
+  std::string name;
+  if (type) {
+    name = type;
+  } else {
+    size_t ext_pos = path.find_last_of('.');
+    size_t stem_pos = path.find_last_of('/');
+    if (ext_pos != std::string::npos &&
+        (stem_pos == std::string::npos || stem_pos < ext_pos)) {
+      name = path.substr(ext_pos + 1);
+    } else {
+      name = "elf";
+    }
+  }
+
+  if (name == "elf")
+    return kMemImageElf;
+  if (name == "vmem")
+    return kMemImageVmem;
+  if (name == "raw" || name == "bin")
+    return kMemImageRaw;
+
+  throw std::runtime_error("Unknown dump type: `" + name + "'.");
+}
+
+static void PrintHelp(const char *argv0) {
+  std::cout << "Usage: " << argv0 << " [--type=TYPE] A B\n\n"
+               "Print the address ranges in which the memory dumps A and B\n"
+               "differ. TYPE is 'elf', 'vmem' or 'raw' and is guessed from\n"
+               "the file extensions by default.\n";
+}
+
+int main(int argc, char **argv) {
+  const struct option long_options[] = {
+      {"type", required_argument, nullptr, 't'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  const char *type = nullptr;
+  while (1) {
+    int c = getopt_long(argc, argv, "t:h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+    switch (c) {
+      case 't':
+        type = optarg;
+        break;
+      case 'h':
+        PrintHelp(argv[0]);
+        return 0;
+      default:
+        PrintHelp(argv[0]);
+        return 2;
+    }
+  }
+  if (argc - optind != 2) {
+    PrintHelp(argv[0]);
+    return 2;
+  }
+
+  MemDump a, b;
+  try {
+    a = ReadMemDump(argv[optind], GetDumpType(argv[optind], type));
+    b = ReadMemDump(argv[optind + 1], GetDumpType(argv[optind + 1], type));
+  } catch (const std::exception &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    return 2;
+  }
+
+  if (a.base != b.base) {
+    std::cout << "Base addresses differ: 0x" << std::hex << a.base << " vs. 0x"
+              << b.base << std::dec << ". Comparing from the start of each."
+              << std::endl;
+  }
+
+  size_t changed_bytes = 0;
+  auto changes = DiffMemDumps(a, b);
+  for (const AddrRange<uint32_t> &rng : changes) {
+    size_t num_bytes = (size_t)(rng.hi - rng.lo) + 1;
+    std::cout << "0x" << std::hex << std::setfill('0') << std::setw(8)
+              << a.base + rng.lo << "-0x" << std::setw(8) << a.base + rng.hi
+              << std::dec << std::setfill(' ') << ": " << num_bytes
+              << (num_bytes == 1 ? " byte" : " bytes") << " differ"
+              << std::endl;
+    changed_bytes += num_bytes;
+  }
+
+  if (changes.empty()) {
+    std::cout << "Dumps are identical." << std::endl;
+    return 0;
+  }
+  std::cout << changes.size()
+            << (changes.size() == 1 ? " range, " : " ranges, ") << changed_bytes
+            << " bytes differ." << std::endl;
+  return 1;
+}
@@ -8,6 +8,8 @@
 
 #include <cassert>
 #include <map>
+#include <utility>
+#include <vector>
 
 // The type used to represent address ranges. This is essentially a std::pair,
 // but we need a operator< custom for the internal map.
@@ -21,7 +23,76 @@ bool operator<(const AddrRange<addr_t> &a, const AddrRange<addr_t> &b) {
   return a.lo < b.lo;
 }
 
-template <typename addr_t, typename val_t>
+// A map stored as a vector of key/value pairs, sorted by key
+//
+// This implements the part of the std::map interface that RangedMap uses, so
+// that it can be used as an alternative storage for RangedMap. Lookups are
+// binary searches over contiguous memory, which is faster than walking the
+// nodes of a std::map for maps with few entries (like the memory regions of a
+// design). Insertions and removals move all entries behind them, which makes
+// them slower for large maps.
+template <typename key_t, typename val_t>
+class SortedVectorMap {
+ public:
+  using value_type = std::pair<key_t, val_t>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  iterator begin() { return vec_.begin(); }
+  iterator end() { return vec_.end(); }
+  const_iterator begin() const { return vec_.begin(); }
+  const_iterator end() const { return vec_.end(); }
+  bool empty() const { return vec_.empty(); }
+  size_t size() const { return vec_.size(); }
+
+  // Find the first entry with a key strictly greater than key
+  iterator upper_bound(const key_t &key) {
+    return vec_.begin() + UpperBoundIdx(key);
+  }
+  const_iterator upper_bound(const key_t &key) const {
+    return vec_.begin() + UpperBoundIdx(key);
+  }
+
+  // Insert an entry, whose key must not be in the map yet
+  iterator insert(value_type &&value) {
+    return vec_.insert(upper_bound(value.first), std::move(value));
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    return vec_.erase(first, last);
+  }
+
+ private:
+  // A binary search without data-dependent branches (the conditional
+  // increment compiles to a conditional move). Lookups hit random entries,
+  // so the branches of std::upper_bound would mispredict half of the time.
+  size_t UpperBoundIdx(const key_t &key) const {
+    size_t len = vec_.size();
+    if (len == 0) {
+      return 0;
+    }
+
+    // The result is always in [lo, lo + len]
+    size_t lo = 0;
+    while (len > 1) {
+      size_t half = len / 2;
+      lo += (key < vec_[lo + half].first) ? 0 : half;
+      len -= half;
+    }
+    return lo + ((key < vec_[lo].first) ? 0 : 1);
+  }
+
+  std::vector<value_type> vec_;
+};
+
+// A map from disjoint address ranges to values
+//
+// The entries are held in a storage_t, which must implement the std::map
+// interface used here. The default, std::map, has cheap insertions and
+// removals. SortedVectorMap (see FlatRangedMap below) has faster lookups when
+// there are few entries.
+template <typename addr_t, typename val_t,
+          typename storage_t = std::map<AddrRange<addr_t>, val_t>>
 class RangedMap {
  public:
   using rng_t = AddrRange<addr_t>;
@@ -146,7 +217,7 @@ class RangedMap {
   }
 
   // Iteration interface
-  using map_t = std::map<rng_t, val_t>;
+  using map_t = storage_t;
   using const_iterator = typename map_t::const_iterator;
 
   const_iterator begin() const { return const_iterator(map_.begin()); }
@@ -177,7 +248,13 @@ class RangedMap {
   }
 
  private:
-  std::map<rng_t, val_t> map_;
+  map_t map_;
 };
 
+// A RangedMap stored in a sorted vector, for maps which see many more lookups
+// than insertions
+template <typename addr_t, typename val_t>
+using FlatRangedMap =
+    RangedMap<addr_t, val_t, SortedVectorMap<AddrRange<addr_t>, val_t>>;
+
 #endif  // OPENTITAN_HW_DV_VERILATOR_CPP_RANGED_MAP_H_
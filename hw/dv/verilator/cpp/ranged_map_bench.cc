@@ -0,0 +1,130 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Benchmark of the storage backends of RangedMap
+//
+// This compares RangedMap (stored in a std::map) and FlatRangedMap (stored in
+// a sorted vector) for the two ways DpiMemUtil uses them: address lookups in
+// a handful of registered memory regions, and staging many ELF segments,
+// some of which overlap and have to be merged.
+//
+// Run with
+//   bazel run //hw/dv:ranged_map_bench
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ranged_map.h"
+
+namespace {
+
+// Merge function which keeps the newer value, like a segment overwriting an
+// older one.
+template <typename val_t>
+val_t KeepNewer(const AddrRange<uint32_t> &rng0, val_t &&val0,
+                const AddrRange<uint32_t> &rng1, val_t &&val1) {
+  return std::move(val1);
+}
+
+// Run fun and return the achieved operations per second, given that it does
+// num_ops operations.
+template <typename fun_t>
+double MeasureOpsPerSec(size_t num_ops, fun_t fun) {
+  auto begin = std::chrono::steady_clock::now();
+  fun();
+  std::chrono::duration<double> duration =
+      std::chrono::steady_clock::now() - begin;
+  return num_ops / duration.count();
+}
+
+void PrintResult(const std::string &name, double tree_ops_per_s,
+                 double flat_ops_per_s) {
+  std::cout << std::left << std::setw(36) << name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(10)
+            << tree_ops_per_s / 1e6 << " M/s" << std::setw(10)
+            << flat_ops_per_s / 1e6 << " M/s" << std::setw(8)
+            << flat_ops_per_s / tree_ops_per_s << "x" << std::endl;
+}
+
+// Look up random addresses in num_regions regions of 64 KiB with gaps of the
+// same size between them.
+template <typename map_t>
+double BenchLookup(size_t num_regions, size_t num_lookups) {
+  map_t map;
+  for (size_t i = 0; i < num_regions; ++i) {
+    uint32_t base = i * 0x20000;
+    size_t val = i;
+    map.EmplaceDisjoint(base, base + 0xffff, std::move(val));
+  }
+
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<uint32_t> dist(0, num_regions * 0x20000 - 1);
+  std::vector<uint32_t> addrs(num_lookups);
+  for (uint32_t &addr : addrs) {
+    addr = dist(rng);
+  }
+
+  size_t hits = 0;
+  double ops_per_s = MeasureOpsPerSec(num_lookups, [&] {
+    for (uint32_t addr : addrs) {
+      hits += map.find(addr) != map.end();
+    }
+  });
+
+  // Make sure the lookups can't be optimised away
+  if (hits > num_lookups) {
+    std::cerr << "Impossible number of hits" << std::endl;
+  }
+  return ops_per_s;
+}
+
+// Insert num_segs segments of random size at random word-aligned offsets of a
+// 1 MiB memory. Many of them overlap and get merged.
+template <typename map_t>
+double BenchMerge(size_t num_segs) {
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<uint32_t> base_dist(0, 0xfffff / 4);
+  std::uniform_int_distribution<uint32_t> size_dist(1, 0x400);
+
+  map_t map;
+  return MeasureOpsPerSec(num_segs, [&] {
+    for (size_t i = 0; i < num_segs; ++i) {
+      uint32_t base = 4 * base_dist(rng);
+      uint32_t top = std::min(base + size_dist(rng), 0xfffffu);
+      size_t val = i;
+      map.Emplace(base, top, std::move(val), KeepNewer<size_t>);
+    }
+  });
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  using TreeMap = RangedMap<uint32_t, size_t>;
+  using FlatMap = FlatRangedMap<uint32_t, size_t>;
+
+  const size_t kNumLookups = 10000000;
+
+  std::cout << std::left << std::setw(36) << "Benchmark" << std::right
+            << std::setw(14) << "std::map" << std::setw(14) << "vector"
+            << std::setw(9) << "speedup" << std::endl;
+
+  for (size_t num_regions : {4, 8, 16, 64, 1024}) {
+    PrintResult("lookup, " + std::to_string(num_regions) + " regions",
+                BenchLookup<TreeMap>(num_regions, kNumLookups),
+                BenchLookup<FlatMap>(num_regions, kNumLookups));
+  }
+
+  for (size_t num_segs : {100, 10000, 100000}) {
+    PrintResult("merge, " + std::to_string(num_segs) + " segments",
+                BenchMerge<TreeMap>(num_segs), BenchMerge<FlatMap>(num_segs));
+  }
+
+  return 0;
+}
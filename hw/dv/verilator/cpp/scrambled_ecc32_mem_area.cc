@@ -6,6 +6,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -87,6 +89,10 @@ int simutil_get_scramble_nonce(svBitVecVal *nonce);
 }
 
 std::vector<uint8_t> ScrambledEcc32MemArea::GetScrambleKey() const {
+  if (encoding_held_) {
+    return held_key_;
+  }
+
   SVScoped scoped(scr_scope_);
   svBitVecVal key_minibuf[((kPrinceWidthByte * 2) + 3) / 4];
 
@@ -100,6 +106,10 @@ std::vector<uint8_t> ScrambledEcc32MemArea::GetScrambleKey() const {
 }
 
 std::vector<uint8_t> ScrambledEcc32MemArea::GetScrambleNonce() const {
+  if (encoding_held_) {
+    return held_nonce_;
+  }
+
   assert(GetNonceWidthByte() <= kScrMaxNonceWidthByte);
 
   SVScoped scoped(scr_scope_);
@@ -121,11 +131,60 @@ ScrambledEcc32MemArea::ScrambledEcc32MemArea(const std::string &scope,
                                             "u_prim_ram_1p_adv.gen_ram_inst[0]."
                                             "u_mem"),
                    size, width_32),
-      scr_scope_(scope) {
+      scr_scope_(scope),
+      encoding_held_(false) {
   addr_width_ = vbits(size);
   repeat_keystream_ = repeat_keystream;
 }
 
+void ScrambledEcc32MemArea::HoldEncoding() const {
+  // Read both before setting encoding_held_, which makes the getters return
+  // the held values.
+  std::vector<uint8_t> key = GetScrambleKey();
+  std::vector<uint8_t> nonce = GetScrambleNonce();
+  if (phys_addrs_.empty() || nonce != phys_addrs_nonce_) {
+    phys_addrs_ =
+        scramble_addr_table(num_words_, addr_width_, nonce, GetNonceWidth());
+    logical_addrs_.assign((size_t)1 << addr_width_, UINT32_MAX);
+    for (uint32_t addr = 0; addr < num_words_; ++addr) {
+      logical_addrs_[phys_addrs_[addr]] = addr;
+    }
+    phys_addrs_nonce_ = nonce;
+  }
+  held_key_.swap(key);
+  held_nonce_.swap(nonce);
+  encoding_held_ = true;
+}
+
+void ScrambledEcc32MemArea::ReleaseEncoding() const {
+  encoding_held_ = false;
+  held_key_.clear();
+  held_nonce_.clear();
+}
+
+void ScrambledEcc32MemArea::Fill(uint32_t word_offset, uint32_t num_words,
+                                 uint8_t value) const {
+  std::vector<uint8_t> words((size_t)SV_MEM_BLOCK_WORDS * width_byte_, value);
+  WriteWords(word_offset, num_words,
+             [&](uint8_t *block, const uint32_t *dst_words, uint32_t n) {
+               WriteBufferBlock(block, words.data(), dst_words, n);
+             });
+}
+
+std::string ScrambledEcc32MemArea::GetEncodingId() const {
+  std::ostringstream oss;
+  oss << "scrambled_ecc32," << (repeat_keystream_ ? "repeat" : "no-repeat")
+      << ",key=" << std::hex << std::setfill('0');
+  for (uint8_t byte : GetScrambleKey()) {
+    oss << std::setw(2) << (unsigned)byte;
+  }
+  oss << ",nonce=";
+  for (uint8_t byte : GetScrambleNonce()) {
+    oss << std::setw(2) << (unsigned)byte;
+  }
+  return oss.str();
+}
+
 uint32_t ScrambledEcc32MemArea::GetPhysWidth() const {
   return (GetWidthByte() / 4) * 39;
 }
@@ -151,62 +210,86 @@ uint32_t ScrambledEcc32MemArea::GetNonceWidthByte() const {
 }
 
 void ScrambledEcc32MemArea::WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                                        const std::vector<uint8_t> &data,
+                                        const uint8_t *data, size_t data_size,
                                         size_t start_idx,
                                         uint32_t dst_word) const {
   // Compute integrity
-  Ecc32MemArea::WriteBuffer(buf, data, start_idx, dst_word);
-  ScrambleBuffer(buf, dst_word);
+  Ecc32MemArea::WriteBuffer(buf, data, data_size, start_idx, dst_word);
+  ScrambleWords(buf, &dst_word, 1);
 }
 
-std::vector<uint8_t> ScrambledEcc32MemArea::ReadUnscrambled(
-    const uint8_t buf[SV_MEM_WIDTH_BYTES], uint32_t src_word) const {
-  std::vector<uint8_t> scrambled_data(buf, buf + GetPhysWidthByte());
-  return scramble_decrypt_data(scrambled_data, GetPhysWidth(), 39,
-                               AddrIntToBytes(src_word, addr_width_),
-                               addr_width_, GetScrambleNonce(),
-                               GetScrambleKey(), repeat_keystream_, false);
+void ScrambledEcc32MemArea::WriteBufferBlock(uint8_t *block,
+                                             const uint8_t *data,
+                                             const uint32_t *dst_words,
+                                             uint32_t num_words) const {
+  // Compute integrity for the whole block, then scramble it
+  Ecc32MemArea::WriteBufferBlock(block, data, dst_words, num_words);
+  ScrambleWords(block, dst_words, num_words);
 }
 
-void ScrambledEcc32MemArea::ReadBuffer(std::vector<uint8_t> &data,
-                                       const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                                       uint32_t src_word) const {
-  std::vector<uint8_t> unscrambled_data = ReadUnscrambled(buf, src_word);
-  // Strip integrity to give final result
-  Ecc32MemArea::ReadBuffer(data, &unscrambled_data[0], src_word);
+void ScrambledEcc32MemArea::ReadBufferBlock(uint8_t *data,
+                                            const uint8_t *block,
+                                            const uint32_t *src_words,
+                                            uint32_t num_words) const {
+  uint8_t unscrambled[SV_MEM_BLOCK_BYTES];
+  for (uint32_t i = 0; i < num_words; i += SV_MEM_BLOCK_WORDS) {
+    uint32_t n = std::min(num_words - i, (uint32_t)SV_MEM_BLOCK_WORDS);
+    memcpy(unscrambled, &block[(size_t)i * SV_MEM_WIDTH_BYTES],
+           (size_t)n * SV_MEM_WIDTH_BYTES);
+    UnscrambleWords(unscrambled, &src_words[i], n);
+    // Strip integrity to give final result
+    Ecc32MemArea::ReadBufferBlock(&data[(size_t)i * width_byte_], unscrambled,
+                                  &src_words[i], n);
+  }
 }
 
 void ScrambledEcc32MemArea::ReadBufferWithIntegrity(
     EccWords &data, const uint8_t buf[SV_MEM_WIDTH_BYTES],
     uint32_t src_word) const {
-  std::vector<uint8_t> unscrambled_data = ReadUnscrambled(buf, src_word);
-  Ecc32MemArea::ReadBufferWithIntegrity(data, &unscrambled_data[0], src_word);
+  uint8_t unscrambled[SV_MEM_WIDTH_BYTES];
+  memcpy(unscrambled, buf, SV_MEM_WIDTH_BYTES);
+  UnscrambleWords(unscrambled, &src_word, 1);
+  Ecc32MemArea::ReadBufferWithIntegrity(data, unscrambled, src_word);
 }
 
 void ScrambledEcc32MemArea::WriteBufferWithIntegrity(
     uint8_t buf[SV_MEM_WIDTH_BYTES], const EccWords &data, size_t start_idx,
     uint32_t dst_word) const {
   Ecc32MemArea::WriteBufferWithIntegrity(buf, data, start_idx, dst_word);
-  ScrambleBuffer(buf, dst_word);
+  ScrambleWords(buf, &dst_word, 1);
 }
 
-void ScrambledEcc32MemArea::ScrambleBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                                           uint32_t dst_word) const {
-  std::vector<uint8_t> scramble_buf(buf, buf + GetPhysWidthByte());
-
+void ScrambledEcc32MemArea::ScrambleWords(uint8_t *block,
+                                          const uint32_t *dst_words,
+                                          uint32_t num_words) const {
   // Scramble data with integrity
-  scramble_buf = scramble_encrypt_data(
-      scramble_buf, GetPhysWidth(), 39, AddrIntToBytes(dst_word, addr_width_),
-      addr_width_, GetScrambleNonce(), GetScrambleKey(), repeat_keystream_,
-      false);
+  scramble_encrypt_words_at(block, SV_MEM_WIDTH_BYTES, num_words,
+                            GetPhysWidth(), 39, dst_words, addr_width_,
+                            GetScrambleNonce(), GetScrambleKey(),
+                            repeat_keystream_, false);
+}
 
-  // Copy scrambled data to write buffer
-  std::copy(scramble_buf.begin(), scramble_buf.end(), &buf[0]);
+void ScrambledEcc32MemArea::UnscrambleWords(uint8_t *block,
+                                            const uint32_t *src_words,
+                                            uint32_t num_words) const {
+  scramble_decrypt_words_at(block, SV_MEM_WIDTH_BYTES, num_words,
+                            GetPhysWidth(), 39, src_words, addr_width_,
+                            GetScrambleNonce(), GetScrambleKey(),
+                            repeat_keystream_, false);
 }
 
 uint32_t ScrambledEcc32MemArea::ToPhysAddr(uint32_t logical_addr) const {
+  assert(logical_addr < num_words_);
+  if (encoding_held_) {
+    return phys_addrs_[logical_addr];
+  }
+
   // Scramble logical address to get physical address
   return AddrBytesToInt(scramble_addr(AddrIntToBytes(logical_addr, addr_width_),
                                       addr_width_, GetScrambleNonce(),
                                       GetNonceWidth()));
 }
+
+const std::vector<uint32_t> *ScrambledEcc32MemArea::GetLogicalAddrs() const {
+  return encoding_held_ ? &logical_addrs_ : nullptr;
+}
@@ -32,17 +32,39 @@ class ScrambledEcc32MemArea : public Ecc32MemArea {
   ScrambledEcc32MemArea(const std::string &scope, uint32_t size,
                         uint32_t width_32, bool repeat_keystream = true);
 
+  /** Fill words with a constant byte value
+   *
+   * Scrambling makes every physical word different, so this encodes and
+   * writes the words a block at a time, like Write() does.
+   */
+  void Fill(uint32_t word_offset, uint32_t num_words,
+            uint8_t value) const override;
+
+  /** The encoding depends on the current scrambling key and nonce */
+  std::string GetEncodingId() const override;
+
+  /** Read the scrambling key and nonce and hold them
+   *
+   * This also computes the physical address of every word and its inverse,
+   * unless they were already computed for the same nonce. While the encoding
+   * is held, ToPhysAddr() looks addresses up in that table.
+   */
+  void HoldEncoding() const override;
+  void ReleaseEncoding() const override;
+  bool IsEncodingHeld() const override { return encoding_held_; }
+
  private:
-  void WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES],
-                   const std::vector<uint8_t> &data, size_t start_idx,
+  void WriteBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES], const uint8_t *data,
+                   size_t data_size, size_t start_idx,
                    uint32_t dst_word) const override;
 
-  std::vector<uint8_t> ReadUnscrambled(const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                                       uint32_t src_word) const;
+  void WriteBufferBlock(uint8_t *block, const uint8_t *data,
+                        const uint32_t *dst_words,
+                        uint32_t num_words) const override;
 
-  void ReadBuffer(std::vector<uint8_t> &data,
-                  const uint8_t buf[SV_MEM_WIDTH_BYTES],
-                  uint32_t src_word) const override;
+  void ReadBufferBlock(uint8_t *data, const uint8_t *block,
+                       const uint32_t *src_words,
+                       uint32_t num_words) const override;
 
   void ReadBufferWithIntegrity(EccWords &data,
                                const uint8_t buf[SV_MEM_WIDTH_BYTES],
@@ -52,10 +74,23 @@ class ScrambledEcc32MemArea : public Ecc32MemArea {
                                 const EccWords &data, size_t start_idx,
                                 uint32_t dst_word) const override;
 
-  void ScrambleBuffer(uint8_t buf[SV_MEM_WIDTH_BYTES], uint32_t dst_word) const;
+  /** Scramble num_words words in the slots of block in place, word i having
+   * logical address dst_words[i]
+   */
+  void ScrambleWords(uint8_t *block, const uint32_t *dst_words,
+                     uint32_t num_words) const;
+
+  /** Undo ScrambleWords() */
+  void UnscrambleWords(uint8_t *block, const uint32_t *src_words,
+                       uint32_t num_words) const;
 
   uint32_t ToPhysAddr(uint32_t logical_addr) const override;
 
+  /** While the encoding is held, this returns the inverse of the table of
+   * physical addresses, so that large transfers fill whole blocks
+   */
+  const std::vector<uint32_t> *GetLogicalAddrs() const override;
+
   uint32_t GetPhysWidth() const;
   uint32_t GetPhysWidthByte() const;
   uint32_t GetPrinceReplications() const;
@@ -68,6 +103,19 @@ class ScrambledEcc32MemArea : public Ecc32MemArea {
   std::string scr_scope_;
   uint32_t addr_width_;
   bool repeat_keystream_;
+
+  // Key and nonce read by HoldEncoding()
+  mutable bool encoding_held_;
+  mutable std::vector<uint8_t> held_key_;
+  mutable std::vector<uint8_t> held_nonce_;
+
+  // Physical address of each word for the nonce in phys_addrs_nonce_, and
+  // the logical address at each physical address (UINT32_MAX where there is
+  // no word). The address scrambling only depends on the nonce, so these are
+  // kept across holds until the nonce changes.
+  mutable std::vector<uint32_t> phys_addrs_;
+  mutable std::vector<uint32_t> logical_addrs_;
+  mutable std::vector<uint8_t> phys_addrs_nonce_;
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_CPP_SCRAMBLED_ECC32_MEM_AREA_H_
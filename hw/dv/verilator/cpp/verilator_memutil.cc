@@ -4,15 +4,22 @@
 
 #include "verilator_memutil.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <getopt.h>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <vector>
 
+#include "verilator_sim_ctrl.h"
+
 namespace {
 // An instruction to load the file at filepath to the memory called name. If
 // name is the empty string then type must be kMemImageElf and this is an
@@ -24,6 +31,33 @@ struct LoadArg {
 };
 }  // namespace
 
+// Split a command-line argument at commas into at most max_fields fields.
+//
+// Return true on success. On failure (too many or empty fields), return false
+// and write an error message to err_msg.
+static bool SplitArg(const std::string &argument, size_t max_fields,
+                     std::vector<std::string> *fields, std::string *err_msg) {
+  fields->clear();
+  size_t pos = 0;
+  while (true) {
+    size_t end_pos = argument.find(',', pos);
+    std::string field = argument.substr(
+        pos, end_pos == std::string::npos ? end_pos : end_pos - pos);
+    if (field.empty() || fields->size() == max_fields) {
+      std::ostringstream oss;
+      oss << (field.empty() ? "empty field in: `" : "too many fields in: `")
+          << argument << "'.";
+      *err_msg = oss.str();
+      return false;
+    }
+    fields->push_back(field);
+    if (end_pos == std::string::npos) {
+      return true;
+    }
+    pos = end_pos + 1;
+  }
+}
+
 // Parse a meminit command-line argument and write the result to the
 // mem_arg output pointer. The command-line argument should be of the
 // form mem_area,file[,type].
@@ -74,6 +108,82 @@ static bool ParseMemArg(const std::string mem_argument, LoadArg *load_arg,
   return true;
 }
 
+// Parse a memdump command-line argument of the form
+// name,file[,type[,cycle]] and write the result to dump_arg. If no cycle is
+// given, dump_arg->cycle is 0.
+//
+// Return true on success. On failure, return false and write an error
+// message to err_msg.
+static bool ParseMemDumpArg(const std::string &argument, MemDumpArg *dump_arg,
+                            std::string *err_msg) {
+  std::vector<std::string> fields;
+  if (!SplitArg(argument, 4, &fields, err_msg)) {
+    return false;
+  }
+  if (fields.size() < 2) {
+    *err_msg = "memdump must be in the format `name,file[,type[,cycle]]'. "
+               "Got: `" + argument + "'.";
+    return false;
+  }
+
+  dump_arg->name = fields[0];
+  dump_arg->filepath = fields[1];
+  dump_arg->type = DpiMemUtil::GetMemImageType(
+      fields[1], fields.size() > 2 ? fields[2].c_str() : nullptr);
+  dump_arg->cycle = 0;
+  if (fields.size() > 3) {
+    if (!VerilatorSimCtrl::ParseUnsignedArg(&dump_arg->cycle, "memdump",
+                                            fields[3].c_str())) {
+      *err_msg = "bad cycle in memdump argument: `" + fields[3] + "'.";
+      return false;
+    }
+    if (dump_arg->cycle == 0) {
+      *err_msg = "memdump cycle must be at least 1. Got: `" + fields[3] + "'.";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Wait for one of the child processes in children to exit, remove it from the
+// map and report its result. Return true if the child exited successfully.
+static bool WaitForChild(std::map<pid_t, std::string> *children) {
+  assert(children && !children->empty());
+
+  int status;
+  pid_t pid;
+  do {
+    pid = waitpid(-1, &status, 0);
+  } while (pid < 0 && errno == EINTR);
+
+  if (pid < 0) {
+    std::cerr << "ERROR: waitpid() failed: " << strerror(errno) << std::endl;
+    children->clear();
+    return false;
+  }
+
+  auto child = children->find(pid);
+  if (child == children->end()) {
+    // Not one of ours (e.g. spawned by a DPI model)
+    return true;
+  }
+
+  bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  std::cout << "Simulation with `" << child->second << "' (PID " << pid
+            << ") ";
+  if (WIFEXITED(status)) {
+    std::cout << "exited with code " << WEXITSTATUS(status) << "." << std::endl;
+  } else if (WIFSIGNALED(status)) {
+    std::cout << "was killed by signal " << WTERMSIG(status) << "."
+              << std::endl;
+  } else {
+    std::cout << "terminated abnormally." << std::endl;
+  }
+
+  children->erase(child);
+  return success;
+}
+
 // Print a usage message to stdout
 static void PrintHelp() {
   std::cout << "Simulation memory utilities:\n\n"
@@ -85,22 +195,56 @@ static void PrintHelp() {
                "  Initialize the FLASH with FILE (elf/vmem)\n\n"
                "-l|--meminit=NAME,FILE[,TYPE]\n"
                "  Initialize memory region NAME with FILE [of TYPE]\n"
-               "  TYPE is either 'elf' or 'vmem'\n\n"
+               "  TYPE is 'elf', 'vmem' or 'raw'\n\n"
                "-E|--load-elf=FILE\n"
                "  Load ELF file, using segment LMAs to pick memory regions\n\n"
                "-l list|--meminit=list\n"
                "  Print registered memory regions\n\n"
+               "--fork-at-cycle=N\n"
+               "  Fork one simulation process per --fork-load-elf when\n"
+               "  reaching cycle N, and exit with the combined result.\n"
+               "  Requires a model built without --threads (e.g. with the\n"
+               "  sim_single_thread target). Forked simulations insert .N\n"
+               "  into the names of trace, statistics and telemetry files.\n"
+               "  DPI models (UART, JTAG, ...) aren't supported after the\n"
+               "  fork, all processes would share their connections\n\n"
+               "--fork-load-elf=FILE\n"
+               "  Load ELF file FILE into a forked simulation process\n"
+               "  (can be given multiple times)\n\n"
+               "--fork-jobs=N\n"
+               "  Run at most N forked simulations at the same time\n"
+               "  (default: number of CPUs)\n\n"
+               "--meminit-cache=DIR\n"
+               "  Cache encoded images of memories with ECC bits or\n"
+               "  scrambling in the existing directory DIR\n\n"
+               "--memdump=NAME,FILE[,TYPE[,CYCLE]]\n"
+               "  Dump the contents of memory region NAME to FILE [as TYPE]\n"
+               "  at the end of the simulation [or when reaching CYCLE]\n"
+               "  TYPE is 'elf', 'vmem' or 'raw' (can be given multiple\n"
+               "  times). Forked simulations append .N to FILE, where N is\n"
+               "  the index of their --fork-load-elf argument\n\n"
+               "--meminit-jobs=N\n"
+               "  Encode the images of memories with ECC bits or scrambling\n"
+               "  on N threads (default: 1)\n\n"
                "--verbose-mem-load\n"
                "  Print a message for each memory load\n\n"
                "-h|--help\n"
                "  Show help\n\n";
 }
 
-VerilatorMemUtil::VerilatorMemUtil() : allocation_(new DpiMemUtil()) {
+VerilatorMemUtil::VerilatorMemUtil()
+    : allocation_(new DpiMemUtil()),
+      verbose_(false),
+      fork_cycle_(0),
+      fork_jobs_(sysconf(_SC_NPROCESSORS_ONLN)) {
   mem_util_ = allocation_.get();
 }
 
-VerilatorMemUtil::VerilatorMemUtil(DpiMemUtil *mem_util) : mem_util_(mem_util) {
+VerilatorMemUtil::VerilatorMemUtil(DpiMemUtil *mem_util)
+    : mem_util_(mem_util),
+      verbose_(false),
+      fork_cycle_(0),
+      fork_jobs_(sysconf(_SC_NPROCESSORS_ONLN)) {
   assert(mem_util);
 }
 
@@ -112,8 +256,14 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
       {"flashinit", required_argument, nullptr, 'f'},
       {"otpinit", required_argument, nullptr, 'o'},
       {"meminit", required_argument, nullptr, 'l'},
+      {"meminit-cache", required_argument, nullptr, 'K'},
+      {"meminit-jobs", required_argument, nullptr, 'j'},
+      {"memdump", required_argument, nullptr, 'D'},
       {"verbose-mem-load", no_argument, nullptr, 'V'},
       {"load-elf", required_argument, nullptr, 'E'},
+      {"fork-at-cycle", required_argument, nullptr, 'C'},
+      {"fork-load-elf", required_argument, nullptr, 'F'},
+      {"fork-jobs", required_argument, nullptr, 'J'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, no_argument, nullptr, 0}};
 
@@ -170,6 +320,48 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
         }
         break;
       }
+      case 'K':
+        mem_util_->SetImageCacheDir(optarg);
+        break;
+      case 'j': {
+        unsigned long jobs;
+        if (!VerilatorSimCtrl::ParseUnsignedArg(&jobs, "meminit-jobs",
+                                                optarg)) {
+          return false;
+        }
+        if (jobs == 0) {
+          std::cerr << "ERROR: meminit-jobs must be at least 1." << std::endl;
+          return false;
+        }
+        mem_util_->SetLoadJobs(jobs);
+        break;
+      }
+      case 'D': {
+        MemDumpArg dump_arg;
+        std::string dump_err_msg;
+        try {
+          if (!ParseMemDumpArg(optarg, &dump_arg, &dump_err_msg)) {
+            std::cerr << "ERROR: " << dump_err_msg << std::endl;
+            return false;
+          }
+        } catch (const std::exception &err) {
+          std::cerr << "ERROR: " << err.what() << std::endl;
+          return false;
+        }
+        if (!mem_util_->IsMemoryRegistered(dump_arg.name)) {
+          std::cerr << "ERROR: `" << dump_arg.name
+                    << "' is not the name of a known memory region. Run with "
+                       "--meminit=list to get a list."
+                    << std::endl;
+          return false;
+        }
+        if (dump_arg.cycle) {
+          cycle_dumps_.emplace(dump_arg.cycle, dump_arg);
+        } else {
+          exit_dumps_.push_back(dump_arg);
+        }
+        break;
+      }
       case 'V':
         verbose = true;
         break;
@@ -177,6 +369,25 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
         load_args.push_back(
             {.name = "", .filepath = optarg, .type = kMemImageElf});
         break;
+      case 'C':
+        if (!VerilatorSimCtrl::ParseUnsignedArg(&fork_cycle_, "fork-at-cycle",
+                                                optarg)) {
+          return false;
+        }
+        break;
+      case 'F':
+        fork_elfs_.push_back(optarg);
+        break;
+      case 'J':
+        if (!VerilatorSimCtrl::ParseUnsignedArg(&fork_jobs_, "fork-jobs",
+                                                optarg)) {
+          return false;
+        }
+        if (fork_jobs_ == 0) {
+          std::cerr << "ERROR: fork-jobs must be at least 1." << std::endl;
+          return false;
+        }
+        break;
       case 'h':
         PrintHelp();
         return true;
@@ -190,8 +401,17 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
     }
   }
 
-  for (const LoadArg &arg : load_args) {
-    try {
+  if (!fork_elfs_.empty() && fork_cycle_ == 0) {
+    std::cerr << "ERROR: fork-load-elf requires a fork-at-cycle argument."
+              << std::endl;
+    return false;
+  }
+  verbose_ = verbose;
+
+  // Stage all loads first, so that the memories can be encoded in parallel.
+  try {
+    mem_util_->StartLoadBatch();
+    for (const LoadArg &arg : load_args) {
       if (!arg.name.empty()) {
         mem_util_->LoadFileToNamedMem(verbose, arg.name, arg.filepath,
                                       arg.type);
@@ -199,11 +419,150 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
         assert(arg.type == kMemImageElf);
         mem_util_->LoadElfToMemories(verbose, arg.filepath);
       }
+    }
+    mem_util_->FinishLoadBatch();
+  } catch (const std::exception &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool VerilatorMemUtil::DumpMemories(const std::vector<MemDumpArg> &dumps) {
+  bool success = true;
+  for (const MemDumpArg &dump : dumps) {
+    try {
+      mem_util_->DumpNamedMem(verbose_, dump.name, dump.filepath, dump.type);
     } catch (const std::exception &err) {
       std::cerr << "ERROR: " << err.what() << std::endl;
-      return false;
+      success = false;
     }
   }
+  return success;
+}
 
-  return true;
+void VerilatorMemUtil::OnClock(unsigned long sim_time) {
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  unsigned long cycle = simctrl.GetCycle();
+
+  // Dumps due in this cycle (or one which was fast-forwarded over)
+  std::vector<MemDumpArg> dumps;
+  while (!cycle_dumps_.empty() && cycle_dumps_.begin()->first <= cycle) {
+    dumps.push_back(cycle_dumps_.begin()->second);
+    cycle_dumps_.erase(cycle_dumps_.begin());
+  }
+  if (!dumps.empty() && !DumpMemories(dumps)) {
+    simctrl.RequestStop(false);
+    return;
+  }
+
+  // Fork in the fork cycle, or the first one after it which is clocked
+  if (fork_elfs_.empty() || cycle < fork_cycle_) {
+    return;
+  }
+
+  // fork() only duplicates the calling thread. The worker threads of a model
+  // verilated with --threads would be missing in the children.
+  if (simctrl.GetModelThreads() > 1) {
+    std::cerr << "ERROR: fork-load-elf requires a model running on a single "
+                 "thread, build it without --threads (e.g. with the "
+                 "sim_single_thread target)."
+              << std::endl;
+    fork_elfs_.clear();
+    simctrl.RequestStop(false);
+    return;
+  }
+
+  // Neither the parent nor the children must fork again.
+  std::vector<std::string> elfs;
+  elfs.swap(fork_elfs_);
+
+  std::cout << "Forking " << elfs.size() << " simulations at cycle " << cycle
+            << "." << std::endl;
+  simctrl.PrepareFork();
+
+  std::map<pid_t, std::string> children;
+  bool success = true;
+  for (size_t child_idx = 0; child_idx < elfs.size(); ++child_idx) {
+    const std::string &elf = elfs[child_idx];
+    while (children.size() >= fork_jobs_) {
+      success &= WaitForChild(&children);
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "ERROR: fork() failed: " << strerror(errno) << std::endl;
+      success = false;
+      break;
+    }
+
+    if (pid == 0) {
+      // Child: load the ELF file and continue with the simulation. Its memory
+      // dumps, traces, statistics and telemetry mustn't overwrite those of
+      // the other children. The DPI models are left alone: all processes
+      // share their sockets and PTYs, and their server threads only run in
+      // the parent.
+      std::string suffix = "." + std::to_string(child_idx);
+      AddDumpSuffix(suffix);
+      simctrl.ContinueForkedChild(suffix);
+      try {
+        mem_util_->LoadElfToMemories(verbose_, elf);
+      } catch (const std::exception &err) {
+        std::cerr << "ERROR: " << err.what() << std::endl;
+        simctrl.RequestStop(false);
+      }
+      return;
+    }
+
+    children[pid] = elf;
+  }
+
+  while (!children.empty()) {
+    success &= WaitForChild(&children);
+  }
+
+  std::cout << "All forked simulations finished"
+            << (success ? " successfully." : ", some of them failed.")
+            << std::endl;
+  // The memories of the parent still hold their state before the fork, the
+  // children have done all dumps.
+  cycle_dumps_.clear();
+  exit_dumps_.clear();
+  simctrl.RequestStop(success);
+}
+
+void VerilatorMemUtil::AddDumpSuffix(const std::string &suffix) {
+  for (auto &pr : cycle_dumps_) {
+    pr.second.filepath += suffix;
+  }
+  for (MemDumpArg &dump : exit_dumps_) {
+    dump.filepath += suffix;
+  }
+}
+
+void VerilatorMemUtil::PostExec() {
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  if (!fork_elfs_.empty()) {
+    std::cerr << "ERROR: The simulation ended before cycle " << fork_cycle_
+              << ", so none of the " << fork_elfs_.size()
+              << " fork-load-elf files were run." << std::endl;
+    simctrl.RequestStop(false);
+  }
+  if (!DumpMemories(exit_dumps_)) {
+    simctrl.RequestStop(false);
+  }
+}
+
+unsigned long VerilatorMemUtil::GetNextActiveCycle(unsigned long cycle) {
+  unsigned long next = fork_elfs_.empty() ? ULONG_MAX : fork_cycle_;
+  if (!cycle_dumps_.empty()) {
+    next = std::min(next, cycle_dumps_.begin()->first);
+  }
+  return next;
+}
+
+unsigned long VerilatorMemUtil::GetClockDivider() const {
+  // OnClock() is only needed to fork and for dumps at given cycles
+  return fork_elfs_.empty() && cycle_dumps_.empty() ? 0 : 1;
 }
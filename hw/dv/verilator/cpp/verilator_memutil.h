@@ -8,11 +8,23 @@
 // A wrapper class that converts a DpiMemutil into a SimCtrlExtension
 //
 
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "dpi_memutil.h"
 #include "sim_ctrl_extension.h"
 
+// An instruction to dump the memory called name to the file at filepath,
+// when reaching the given cycle or at the end of the simulation if cycle is 0.
+struct MemDumpArg {
+  std::string name;
+  std::string filepath;
+  MemImageType type;
+  unsigned long cycle;
+};
+
 class VerilatorMemUtil : public SimCtrlExtension {
  public:
   // No-argument constructor makes a VerilatorMemUtil. Single-argument
@@ -22,6 +34,10 @@ class VerilatorMemUtil : public SimCtrlExtension {
 
   // Declared in SimCtrlExtension
   bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  void PostExec() override;
+  unsigned long GetClockDivider() const override;
+  unsigned long GetNextActiveCycle(unsigned long cycle) override;
 
   // Get underlying DpiMemUtil object
   DpiMemUtil *GetUnderlying() { return mem_util_; }
@@ -35,6 +51,26 @@ class VerilatorMemUtil : public SimCtrlExtension {
  private:
   DpiMemUtil *mem_util_;
   std::unique_ptr<DpiMemUtil> allocation_;
+
+  // Fork fan-out: when the simulation reaches fork_cycle_, fork one child
+  // process per ELF file in fork_elfs_, running at most fork_jobs_ children at
+  // a time. Each child loads its ELF file and continues the simulation, while
+  // the parent collects the exit codes of all children and stops.
+  bool verbose_;
+  unsigned long fork_cycle_;
+  unsigned long fork_jobs_;
+  std::vector<std::string> fork_elfs_;
+
+  // Memory dumps requested with --memdump, either at a given cycle (keyed by
+  // the cycle) or at the end of the simulation.
+  std::multimap<unsigned long, MemDumpArg> cycle_dumps_;
+  std::vector<MemDumpArg> exit_dumps_;
+
+  // Perform dumps, returning false if any of them failed.
+  bool DumpMemories(const std::vector<MemDumpArg> &dumps);
+
+  // Append suffix to the file paths of all requested dumps.
+  void AddDumpSuffix(const std::string &suffix);
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_CPP_VERILATOR_MEMUTIL_H_
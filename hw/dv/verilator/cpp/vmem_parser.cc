@@ -0,0 +1,174 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "vmem_parser.h"
+
+#include <cctype>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+// Size of the chunks the file is read in
+static const size_t kChunkSize = 64 * 1024;
+
+static int HexDigitValue(int c) {
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+VmemParser::VmemParser(const std::string &path, uint32_t max_word_bytes)
+    : path_(path),
+      max_word_bytes_(max_word_bytes),
+      buf_(kChunkSize),
+      buf_pos_(0),
+      buf_end_(0),
+      line_(1),
+      next_addr_(0) {
+  file_ = fopen(path.c_str(), "rb");
+  if (!file_) {
+    std::ostringstream oss;
+    oss << "Failed to load vmem file at `" << path_
+        << "': could not open file.";
+    throw std::runtime_error(oss.str());
+  }
+}
+
+VmemParser::~VmemParser() { fclose(file_); }
+
+void VmemParser::Error(const std::string &msg) const {
+  std::ostringstream oss;
+  oss << "Failed to load vmem file at `" << path_ << "': line " << line_
+      << ": " << msg;
+  throw std::runtime_error(oss.str());
+}
+
+bool VmemParser::Refill() {
+  buf_pos_ = 0;
+  buf_end_ = fread(buf_.data(), 1, buf_.size(), file_);
+  if (!buf_end_ && ferror(file_)) {
+    Error("failed to read file.");
+  }
+  return buf_end_ != 0;
+}
+
+void VmemParser::SkipComment() {
+  int c = Get();
+  if (c == '/') {
+    while ((c = Peek()) != EOF && c != '\n') {
+      ++buf_pos_;
+    }
+    return;
+  }
+  if (c != '*') {
+    Error("stray `/'.");
+  }
+
+  int prev = 0;
+  while ((c = Get()) != EOF) {
+    if (c == '\n') {
+      ++line_;
+    }
+    if (prev == '*' && c == '/') {
+      return;
+    }
+    prev = c;
+  }
+  Error("unterminated comment.");
+}
+
+void VmemParser::ReadDigits(int first) {
+  digits_.clear();
+  int c = first;
+  while (true) {
+    if (c != '_') {
+      if (HexDigitValue(c) < 0) {
+        if (c == 'x' || c == 'X' || c == 'z' || c == 'Z') {
+          Error("unknown (x or z) digits are not supported.");
+        }
+        Error(std::string("invalid character `") + (char)c + "'.");
+      }
+      digits_ += (char)c;
+    }
+
+    c = Peek();
+    if (c == EOF || isspace(c) || c == '/') {
+      break;
+    }
+    ++buf_pos_;
+  }
+
+  if (digits_.empty()) {
+    Error("missing digits.");
+  }
+}
+
+bool VmemParser::Next(uint32_t *addr, uint8_t *word, uint32_t *num_digits) {
+  while (true) {
+    int c = Get();
+    if (c == EOF) {
+      return false;
+    }
+    if (c == '\n') {
+      ++line_;
+      continue;
+    }
+    if (isspace(c)) {
+      continue;
+    }
+    if (c == '/') {
+      SkipComment();
+      continue;
+    }
+
+    if (c == '@') {
+      c = Get();
+      if (c == EOF || isspace(c) || c == '/') {
+        Error("missing address after `@'.");
+      }
+      ReadDigits(c);
+      uint64_t val = 0;
+      for (char digit : digits_) {
+        val = (val << 4) | HexDigitValue(digit);
+        if (val > 0xffffffffu) {
+          Error("address @" + digits_ + " is out of range.");
+        }
+      }
+      next_addr_ = val;
+      continue;
+    }
+
+    ReadDigits(c);
+    if (next_addr_ > 0xffffffffu) {
+      Error("word address is out of range.");
+    }
+
+    // Leading zeros don't count towards the width of the value, but say how
+    // wide the word was meant to be.
+    size_t first_nonzero = digits_.find_first_not_of('0');
+    size_t sig_digits =
+        first_nonzero == std::string::npos ? 0 : digits_.size() - first_nonzero;
+    if (sig_digits > 2 * (size_t)max_word_bytes_) {
+      std::ostringstream oss;
+      oss << "word " << digits_ << " is wider than " << 8 * max_word_bytes_
+          << " bits.";
+      Error(oss.str());
+    }
+
+    memset(word, 0, max_word_bytes_);
+    for (size_t i = 0; i < sig_digits; ++i) {
+      // Digit i counts from the least significant end
+      int val = HexDigitValue(digits_[digits_.size() - 1 - i]);
+      word[i / 2] |= val << (4 * (i % 2));
+    }
+
+    *addr = next_addr_++;
+    *num_digits = digits_.size();
+    return true;
+  }
+}
@@ -0,0 +1,106 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_CPP_VMEM_PARSER_H_
+#define OPENTITAN_HW_DV_VERILATOR_CPP_VMEM_PARSER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * A streaming parser for vmem files
+ *
+ * Vmem files are the hex files read by $readmemh: a sequence of hexadecimal
+ * words, separated by whitespace, and "@ADDR" entries which set the word
+ * address of the next word. Each word is stored at the address following that
+ * of the previous word. Digits can be separated by underscores, and
+ * comments use C syntax.
+ *
+ * The file is read in chunks, so that large files never have to be held in
+ * memory.
+ */
+class VmemParser {
+ public:
+  /**
+   * Open the vmem file at |path| for words of up to |max_word_bytes| bytes
+   *
+   * Raises a std::runtime_error if the file can't be opened.
+   */
+  VmemParser(const std::string &path, uint32_t max_word_bytes);
+  ~VmemParser();
+
+  VmemParser(const VmemParser &) = delete;
+  VmemParser &operator=(const VmemParser &) = delete;
+
+  /**
+   * Parse the next word
+   *
+   * Writes the word address to |addr|, the value to the |max_word_bytes|
+   * bytes at |word| (least significant byte first) and the number of digits
+   * the word was written with (ignoring underscores) to |num_digits|.
+   *
+   * @return false at the end of the file, true otherwise
+   *
+   * Raises a std::runtime_error with the line number if the file is
+   * malformed or can't be read.
+   */
+  bool Next(uint32_t *addr, uint8_t *word, uint32_t *num_digits);
+
+  /**
+   * Raise a std::runtime_error about the current position in the file
+   */
+  [[noreturn]] void Error(const std::string &msg) const;
+
+ private:
+  std::string path_;
+  uint32_t max_word_bytes_;
+  FILE *file_;
+
+  std::vector<char> buf_;
+  size_t buf_pos_, buf_end_;
+  unsigned line_;
+  uint64_t next_addr_;
+  // The digits of the current token, reused to avoid allocations
+  std::string digits_;
+
+  /**
+   * Return the next character of the file without consuming it, or EOF
+   */
+  int Peek() {
+    if (buf_pos_ == buf_end_ && !Refill()) {
+      return EOF;
+    }
+    return (unsigned char)buf_[buf_pos_];
+  }
+
+  /**
+   * Consume the next character of the file and return it, or EOF
+   */
+  int Get() {
+    int c = Peek();
+    if (c != EOF) {
+      ++buf_pos_;
+    }
+    return c;
+  }
+
+  /**
+   * Read the next chunk of the file into buf_, return false at the end
+   */
+  bool Refill();
+
+  /**
+   * Skip a comment, after its initial '/'
+   */
+  void SkipComment();
+
+  /**
+   * Read the hex digits of a token into digits_, starting with first
+   */
+  void ReadDigits(int first);
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_CPP_VMEM_PARSER_H_
@@ -5,6 +5,11 @@
 #ifndef OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_H_
 #define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_H_
 
+#include <climits>
+
+class VerilatedSerialize;
+class VerilatedDeserialize;
+
 class SimCtrlExtension {
  public:
   virtual ~SimCtrlExtension() = default;
@@ -36,13 +41,64 @@ class SimCtrlExtension {
 
   /**
    * Function to be called every clock cycle
+   *
+   * The function is called on the rising edge of the clock passed to
+   * VerilatorSimCtrl::SetTop(). |sim_time| is the current time in ticks, use
+   * VerilatorSimCtrl::GetCycle() to get the clock cycle.
+   *
+   * @see GetClockDivider()
    */
   virtual void OnClock(unsigned long sim_time) {}
 
+  /**
+   * Get the number of clock cycles between two calls to OnClock()
+   *
+   * The simulation controller queries this after all command line arguments
+   * have been parsed, and again in forked simulations (see
+   * VerilatorSimCtrl::ContinueForkedChild()). Extensions which don't need
+   * OnClock() should return 0 to avoid the call overhead in every cycle.
+   *
+   * @return Clock divider, 0 to never call OnClock()
+   */
+  virtual unsigned long GetClockDivider() const { return 1; }
+
+  /**
+   * Get the next cycle in which this extension needs to be called
+   *
+   * When the simulation is fast-forwarded through an idle period (see
+   * VerilatorSimCtrl::RequestFastForward()), cycles are skipped without
+   * evaluating the design or calling OnClock(). The simulation never skips
+   * beyond the next cycle OnClock() is due in according to GetClockDivider(),
+   * unless this function returns a later cycle. The skipped calls are then
+   * replaced by a single call in the first cycle after the skip.
+   *
+   * @param cycle The current clock cycle
+   * @return The next cycle OnClock() must be called in, ULONG_MAX if none
+   */
+  virtual unsigned long GetNextActiveCycle(unsigned long cycle) {
+    return cycle;
+  }
+
   /**
    * Function to be called after executing the simulation
    */
   virtual void PostExec() {}
+
+  /**
+   * Save the state of the extension into a simulation checkpoint
+   *
+   * Everything written here must be read back in the same order by
+   * RestoreCheckpoint().
+   */
+  virtual void SaveCheckpoint(VerilatedSerialize &os) {}
+
+  /**
+   * Restore the state of the extension from a simulation checkpoint
+   *
+   * This function is called before ParseCLIArguments(), so command line
+   * arguments take precedence over the restored state.
+   */
+  virtual void RestoreCheckpoint(VerilatedDeserialize &is) {}
 };
 
 #endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_H_
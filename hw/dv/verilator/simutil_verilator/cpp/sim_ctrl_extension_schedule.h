@@ -0,0 +1,100 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_SCHEDULE_H_
+#define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_SCHEDULE_H_
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include "sim_ctrl_extension.h"
+
+/**
+ * The schedule of the OnClock() calls of simulation control extensions
+ *
+ * Only extensions with a non-zero clock divider (see
+ * SimCtrlExtension::GetClockDivider()) are part of the schedule. The earliest
+ * cycle in which any of them is due is kept, so that the simulation loop only
+ * has to compare the current cycle against it in all other cycles.
+ */
+class SimCtrlExtensionSchedule {
+ public:
+  SimCtrlExtensionSchedule() : next_cycle_(ULONG_MAX) {}
+
+  /**
+   * Set up the schedule of |extensions|, with all of them due in |cycle|
+   *
+   * The clock dividers are queried once, here.
+   */
+  void Reset(const std::vector<SimCtrlExtension *> &extensions,
+             unsigned long cycle) {
+    entries_.clear();
+    next_cycle_ = ULONG_MAX;
+    for (SimCtrlExtension *ext : extensions) {
+      unsigned long clock_divider = ext->GetClockDivider();
+      if (clock_divider == 0) {
+        continue;
+      }
+      entries_.push_back({ext, clock_divider, cycle});
+      next_cycle_ = cycle;
+    }
+  }
+
+  /**
+   * Is any extension due in |cycle|?
+   */
+  bool IsDue(unsigned long cycle) const { return cycle >= next_cycle_; }
+
+  /**
+   * Call OnClock() of all extensions which are due in |cycle|
+   *
+   * Extensions are called in the order of |extensions| passed to Reset().
+   *
+   * @param sim_time Current time in ticks, passed to OnClock()
+   */
+  void Clock(unsigned long cycle, unsigned long sim_time) {
+    next_cycle_ = ULONG_MAX;
+    for (Entry &entry : entries_) {
+      if (entry.next_cycle <= cycle) {
+        entry.ext->OnClock(sim_time);
+        entry.next_cycle = cycle + entry.clock_divider;
+      }
+      next_cycle_ = std::min(next_cycle_, entry.next_cycle);
+    }
+  }
+
+  /**
+   * Get the latest cycle the simulation can skip to from |cycle|
+   *
+   * Skipping stops at the next due call of every extension, unless the
+   * extension declares to be idle for longer (see
+   * SimCtrlExtension::GetNextActiveCycle()).
+   */
+  unsigned long GetSkipLimit(unsigned long cycle) const {
+    unsigned long limit = ULONG_MAX;
+    for (const Entry &entry : entries_) {
+      limit = std::min(limit, std::max(entry.next_cycle,
+                                       entry.ext->GetNextActiveCycle(cycle)));
+    }
+    return limit;
+  }
+
+ private:
+  /**
+   * An extension with OnClock() calls
+   */
+  struct Entry {
+    SimCtrlExtension *ext;
+    unsigned long clock_divider;
+    unsigned long next_cycle;
+  };
+
+  // Extensions which need OnClock() calls, in order of registration, and the
+  // earliest cycle in which any of them is due.
+  std::vector<Entry> entries_;
+  unsigned long next_cycle_;
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_EXTENSION_SCHEDULE_H_
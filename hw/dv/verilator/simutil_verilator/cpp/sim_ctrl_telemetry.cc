@@ -0,0 +1,187 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "sim_ctrl_telemetry.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Reading the wallclock is comparatively expensive, so only check for the end
+// of a wallclock interval every this many cycles.
+static const unsigned long kWallclockCheckCycles = 1024;
+
+SimCtrlTelemetry::SimCtrlTelemetry()
+    : fd_(-1),
+      is_socket_(false),
+      cycle_interval_(0),
+      wallclock_interval_ms_(0),
+      eval_duration_(0),
+      extension_duration_(0),
+      interval_begin_cycle_(0),
+      next_report_cycle_(0),
+      next_check_cycle_(0) {}
+
+SimCtrlTelemetry::~SimCtrlTelemetry() { Close(); }
+
+bool SimCtrlTelemetry::Open(const std::string &destination) {
+  Close();
+
+  static const std::string unix_prefix("unix:");
+  if (destination.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+    std::string path = destination.substr(unix_prefix.size());
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      std::cerr << "ERROR: Invalid telemetry socket path `" << path << "'."
+                << std::endl;
+      return false;
+    }
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 ||
+        connect(fd_, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) != 0) {
+      std::cerr << "ERROR: Unable to connect to telemetry socket `" << path
+                << "': " << strerror(errno) << std::endl;
+      Close();
+      return false;
+    }
+    is_socket_ = true;
+  } else {
+    fd_ = open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      std::cerr << "ERROR: Unable to open telemetry file `" << destination
+                << "': " << strerror(errno) << std::endl;
+      return false;
+    }
+    is_socket_ = false;
+  }
+
+  destination_ = destination;
+  return true;
+}
+
+bool SimCtrlTelemetry::Reopen(const std::string &suffix) {
+  if (!IsEnabled()) {
+    return true;
+  }
+
+  name_ += suffix;
+  if (is_socket_) {
+    return Open(destination_);
+  }
+  return Open(destination_ + suffix);
+}
+
+void SimCtrlTelemetry::Start(const std::string &name, unsigned long cycle) {
+  if (!IsEnabled()) {
+    return;
+  }
+
+  // Report at least every 10 seconds if no interval has been chosen
+  if (!cycle_interval_ && !wallclock_interval_ms_) {
+    wallclock_interval_ms_ = 10000;
+  }
+
+  name_ = name;
+  start_ = std::chrono::steady_clock::now();
+  interval_begin_ = start_;
+  interval_begin_cycle_ = cycle;
+  eval_duration_ = std::chrono::steady_clock::duration(0);
+  extension_duration_ = std::chrono::steady_clock::duration(0);
+  next_report_cycle_ = cycle_interval_ ? cycle + cycle_interval_ : ULONG_MAX;
+  next_check_cycle_ = std::min(
+      next_report_cycle_,
+      wallclock_interval_ms_ ? cycle + kWallclockCheckCycles : ULONG_MAX);
+}
+
+void SimCtrlTelemetry::CheckInterval(unsigned long cycle) {
+  bool report_due = cycle >= next_report_cycle_;
+  if (!report_due && wallclock_interval_ms_) {
+    auto elapsed = std::chrono::steady_clock::now() - interval_begin_;
+    report_due = elapsed >= std::chrono::milliseconds(wallclock_interval_ms_);
+  }
+
+  if (report_due) {
+    Report(cycle);
+    if (cycle_interval_) {
+      next_report_cycle_ = cycle + cycle_interval_;
+    }
+  }
+
+  next_check_cycle_ = std::min(
+      next_report_cycle_,
+      wallclock_interval_ms_ ? cycle + kWallclockCheckCycles : ULONG_MAX);
+}
+
+void SimCtrlTelemetry::Report(unsigned long cycle) {
+  auto now = std::chrono::steady_clock::now();
+  double interval_s =
+      std::chrono::duration<double>(now - interval_begin_).count();
+  double wallclock_s = std::chrono::duration<double>(now - start_).count();
+  double eval_s = std::chrono::duration<double>(eval_duration_).count();
+  double extension_s =
+      std::chrono::duration<double>(extension_duration_).count();
+
+  double cycles_per_s = 0, eval_share = 0, extension_share = 0;
+  if (interval_s > 0) {
+    cycles_per_s = (cycle - interval_begin_cycle_) / interval_s;
+    eval_share = eval_s / interval_s;
+    extension_share = extension_s / interval_s;
+  }
+
+  std::ostringstream report;
+  report << "{\"name\":\"" << name_ << "\",\"cycle\":" << cycle
+         << ",\"wallclock_s\":" << wallclock_s
+         << ",\"cycles_per_s\":" << cycles_per_s
+         << ",\"eval_share\":" << eval_share
+         << ",\"extension_share\":" << extension_share << "}\n";
+  std::string line = report.str();
+
+  ssize_t written;
+  if (is_socket_) {
+    // Don't get killed by SIGPIPE if the reader went away
+    written = send(fd_, line.data(), line.size(), MSG_NOSIGNAL);
+  } else {
+    written = write(fd_, line.data(), line.size());
+  }
+  if (written != static_cast<ssize_t>(line.size())) {
+    std::cerr << "WARNING: Unable to write telemetry report, disabling "
+                 "telemetry."
+              << std::endl;
+    Close();
+    return;
+  }
+
+  interval_begin_ = now;
+  interval_begin_cycle_ = cycle;
+  eval_duration_ = std::chrono::steady_clock::duration(0);
+  extension_duration_ = std::chrono::steady_clock::duration(0);
+}
+
+void SimCtrlTelemetry::Finish(unsigned long cycle) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Report(cycle);
+  Close();
+}
+
+void SimCtrlTelemetry::Close() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = -1;
+}
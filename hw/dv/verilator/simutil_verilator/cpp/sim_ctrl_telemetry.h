@@ -0,0 +1,153 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_TELEMETRY_H_
+#define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_TELEMETRY_H_
+
+#include <chrono>
+#include <string>
+
+/**
+ * Periodic performance reports of a running simulation
+ *
+ * While a simulation is running, this class writes one report per interval as
+ * a line of JSON (newline-delimited JSON) to a file or a Unix domain socket.
+ * Every report contains the simulation speed and the share of the wallclock
+ * time spent in model evaluation and in extensions during the last interval,
+ * e.g.
+ *
+ *   {"name":"chip_sim_tb","cycle":1000000,"wallclock_s":12.5,
+ *    "cycles_per_s":81234.5,"eval_share":0.97,"extension_share":0.01}
+ *
+ * All functions are cheap no-ops as long as no destination has been opened.
+ */
+class SimCtrlTelemetry {
+ public:
+  SimCtrlTelemetry();
+  ~SimCtrlTelemetry();
+
+  SimCtrlTelemetry(SimCtrlTelemetry const &) = delete;
+  void operator=(SimCtrlTelemetry const &) = delete;
+
+  /**
+   * Open the destination of the reports
+   *
+   * @param destination Path of a file, or "unix:PATH" to connect to a Unix
+   *                    domain socket listening at PATH
+   * @return Return code, true == success
+   */
+  bool Open(const std::string &destination);
+
+  /**
+   * Reopen the report destination in a forked process
+   *
+   * Appends |suffix| to the name of the simulation in the reports and to the
+   * path of a file destination. Socket destinations are connected to again,
+   * so that every process has its own connection.
+   *
+   * @return Return code, true == success
+   */
+  bool Reopen(const std::string &suffix);
+
+  /**
+   * Is a report destination open?
+   */
+  bool IsEnabled() const { return fd_ >= 0; }
+
+  /**
+   * Report every |cycles| clock cycles (0 to disable)
+   */
+  void SetCycleInterval(unsigned long cycles) { cycle_interval_ = cycles; }
+
+  /**
+   * Report every |ms| milliseconds of wallclock time (0 to disable)
+   */
+  void SetWallclockInterval(unsigned long ms) { wallclock_interval_ms_ = ms; }
+
+  /**
+   * Start the first interval
+   *
+   * @param name Name of the simulation, included in every report
+   * @param cycle Current clock cycle
+   */
+  void Start(const std::string &name, unsigned long cycle);
+
+  /**
+   * Mark the start and the end of a model evaluation
+   */
+  void BeginEval() {
+    if (IsEnabled()) {
+      section_begin_ = std::chrono::steady_clock::now();
+    }
+  }
+  void EndEval() {
+    if (IsEnabled()) {
+      eval_duration_ += std::chrono::steady_clock::now() - section_begin_;
+    }
+  }
+
+  /**
+   * Mark the start and the end of calls to extensions
+   */
+  void BeginExtensions() {
+    if (IsEnabled()) {
+      section_begin_ = std::chrono::steady_clock::now();
+    }
+  }
+  void EndExtensions() {
+    if (IsEnabled()) {
+      extension_duration_ += std::chrono::steady_clock::now() - section_begin_;
+    }
+  }
+
+  /**
+   * Write a report if the current interval is over
+   *
+   * Call this once per clock cycle.
+   */
+  void OnCycle(unsigned long cycle) {
+    if (IsEnabled() && cycle >= next_check_cycle_) {
+      CheckInterval(cycle);
+    }
+  }
+
+  /**
+   * Write a final report and close the destination
+   */
+  void Finish(unsigned long cycle);
+
+ private:
+  int fd_;
+  bool is_socket_;
+  std::string destination_;
+  std::string name_;
+  unsigned long cycle_interval_;
+  unsigned long wallclock_interval_ms_;
+
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point interval_begin_;
+  std::chrono::steady_clock::time_point section_begin_;
+  std::chrono::steady_clock::duration eval_duration_;
+  std::chrono::steady_clock::duration extension_duration_;
+  unsigned long interval_begin_cycle_;
+  unsigned long next_report_cycle_;
+  unsigned long next_check_cycle_;
+
+  /**
+   * Check whether a report is due, and write it
+   */
+  void CheckInterval(unsigned long cycle);
+
+  /**
+   * Write a report about the interval ending now and start the next one
+   */
+  void Report(unsigned long cycle);
+
+  /**
+   * Close the report destination
+   */
+  void Close();
+};
+
+#endif  // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_SIM_CTRL_TELEMETRY_H_
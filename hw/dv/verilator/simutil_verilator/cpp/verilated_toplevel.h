@@ -10,6 +10,7 @@
 #endif
 
 #include <verilated.h>
+#include <verilated_save.h>
 
 #define STR(s) #s
 #define STR_AND_EXPAND(s) STR(s)
@@ -33,6 +34,9 @@
 
 // VM_TRACE_FMT_FST must be set by the user when calling Verilator with
 // --trace-fst. VM_TRACE is set by Verilator itself.
+// VM_SAVABLE must be set by the user when calling Verilator with --savable.
+// Without it, the model cannot be saved into or restored from a checkpoint.
+
 #if VM_TRACE == 1
 #ifdef VM_TRACE_FMT_FST
 #include "verilated_fst_c.h"
@@ -112,6 +116,9 @@ class TOPLEVEL_NAME;
  * To support the different tracing implementations (VCD, FST or no tracing),
  * the trace() function is modified to take a VerilatedTracer argument instead
  * of the tracer-specific class.
+ *
+ * The save() and restore() functions wrap the serialization operators which
+ * Verilator only generates for models built with --savable.
  */
 class VerilatedToplevel {
  public:
@@ -122,6 +129,8 @@ class VerilatedToplevel {
   virtual void final() = 0;
   virtual const char *name() const = 0;
   virtual void trace(VerilatedTracer &tfp, int levels, int options) = 0;
+  virtual void save(VerilatedSerialize &os) = 0;
+  virtual void restore(VerilatedDeserialize &is) = 0;
 
   /**
    * Get the Verilator-generated device under test
@@ -139,6 +148,8 @@ class TOPLEVEL_NAME : public VERILATED_TOPLEVEL_NAME, public VerilatedToplevel {
  public:
   TOPLEVEL_NAME(const char *name = "TOP")
       : VERILATED_TOPLEVEL_NAME(name), VerilatedToplevel() {}
+  TOPLEVEL_NAME(VerilatedContext *contextp, const char *name = "TOP")
+      : VERILATED_TOPLEVEL_NAME(contextp, name), VerilatedToplevel() {}
   const char *name() const { return STR_AND_EXPAND(TOPLEVEL_NAME); }
   void eval() { VERILATED_TOPLEVEL_NAME::eval(); }
   void final() { VERILATED_TOPLEVEL_NAME::final(); }
@@ -148,6 +159,20 @@ class TOPLEVEL_NAME : public VERILATED_TOPLEVEL_NAME, public VerilatedToplevel {
                                    levels, options);
 #else
     assert(0 && "Tracing not enabled.");
+#endif
+  }
+  void save(VerilatedSerialize &os) {
+#ifdef VM_SAVABLE
+    os << static_cast<VERILATED_TOPLEVEL_NAME &>(*this);
+#else
+    assert(0 && "Checkpointing not enabled.");
+#endif
+  }
+  void restore(VerilatedDeserialize &is) {
+#ifdef VM_SAVABLE
+    is >> static_cast<VERILATED_TOPLEVEL_NAME &>(*this);
+#else
+    assert(0 && "Checkpointing not enabled.");
 #endif
   }
 };
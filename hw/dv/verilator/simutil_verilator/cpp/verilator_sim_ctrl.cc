@@ -4,10 +4,18 @@
 
 #include "verilator_sim_ctrl.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
 #include <getopt.h>
+#include <iomanip>
 #include <iostream>
 #include <signal.h>
+#include <sstream>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <verilated.h>
 
 // This is defined by Verilator and passed through the command line
@@ -15,6 +23,13 @@
 #define VM_TRACE 0
 #endif
 
+// This is defined by the user together with Verilator's --savable option
+#ifdef VM_SAVABLE
+#define CHECKPOINT_POSSIBLE 1
+#else
+#define CHECKPOINT_POSSIBLE 0
+#endif
+
 /**
  * Get the current simulation time
  *
@@ -22,6 +37,34 @@
  */
 double sc_time_stamp() { return VerilatorSimCtrl::GetInstance().GetTime(); }
 
+/**
+ * Trigger the waveform capture from SystemVerilog
+ *
+ * Import into SystemVerilog code with
+ *   import "DPI-C" function void simctrl_trace_trigger();
+ *
+ * @see VerilatorSimCtrl::TraceTrigger()
+ */
+extern "C" void simctrl_trace_trigger() {
+  VerilatorSimCtrl::GetInstance().TraceTrigger();
+}
+
+/**
+ * Skip idle cycles from SystemVerilog
+ *
+ * Import into SystemVerilog code with
+ *   import "DPI-C" function void simctrl_fast_forward(int unsigned cycles);
+ *
+ * and call it from code which knows that the design does nothing in the next
+ * |cycles| clock cycles, e.g. a monitor of a sleep test.
+ *
+ * @see VerilatorSimCtrl::RequestFastForward()
+ */
+extern "C" void simctrl_fast_forward(unsigned int cycles) {
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  simctrl.RequestFastForward(simctrl.GetCycle() + cycles);
+}
+
 #ifdef VL_USER_STOP
 /**
  * A simulation stop was requested, e.g. through $stop() or $error()
@@ -34,17 +77,101 @@ void vl_stop(const char *filename, int linenum, const char *hier) VL_MT_UNSAFE {
 }
 #endif
 
+/**
+ * Get the CPU time (user and system) consumed by each thread of this process
+ *
+ * The result maps the kernel thread ID to the consumed CPU time in seconds. On
+ * systems without procfs an empty map is returned.
+ */
+static std::map<long, double> GetThreadCpuTimes() {
+  std::map<long, double> cpu_times;
+
+  DIR *task_dir = opendir("/proc/self/task");
+  if (!task_dir) {
+    return cpu_times;
+  }
+
+  double ticks_per_s = sysconf(_SC_CLK_TCK);
+  struct dirent *task;
+  while ((task = readdir(task_dir)) != nullptr) {
+    if (task->d_name[0] == '.') {
+      continue;
+    }
+
+    std::ifstream stat_file(std::string("/proc/self/task/") + task->d_name +
+                            "/stat");
+    std::string stat;
+    if (!std::getline(stat_file, stat)) {
+      continue;
+    }
+
+    // The second field is the thread name in parentheses, which can contain
+    // spaces. Start parsing after it, at the third field (the thread state).
+    size_t comm_end = stat.rfind(')');
+    if (comm_end == std::string::npos) {
+      continue;
+    }
+    std::istringstream fields(stat.substr(comm_end + 1));
+    std::string skipped;
+    for (int field = 3; field < 14; ++field) {
+      fields >> skipped;
+    }
+    unsigned long utime, stime;
+    if (!(fields >> utime >> stime)) {
+      continue;
+    }
+
+    cpu_times[strtol(task->d_name, nullptr, 10)] =
+        (utime + stime) / ticks_per_s;
+  }
+
+  closedir(task_dir);
+  return cpu_times;
+}
+
+/**
+ * Insert |suffix| into |path| before the file extension, e.g. sim.1.fst
+ */
+static std::string InsertBeforeExtension(const std::string &path,
+                                         const std::string &suffix) {
+  size_t ext_pos = path.rfind('.');
+  size_t dir_pos = path.rfind('/');
+  if (ext_pos == std::string::npos ||
+      (dir_pos != std::string::npos && ext_pos < dir_pos)) {
+    return path + suffix;
+  }
+  std::string file_name(path);
+  return file_name.insert(ext_pos, suffix);
+}
+
 VerilatorSimCtrl &VerilatorSimCtrl::GetInstance() {
   static VerilatorSimCtrl instance;
   return instance;
 }
 
 void VerilatorSimCtrl::SetTop(VerilatedToplevel *top, CData *sig_clk,
-                              CData *sig_rst, VerilatorSimCtrlFlags flags) {
+                              CData *sig_rst, VerilatorSimCtrlFlags flags,
+                              VerilatedContext *context) {
   top_ = top;
+  context_ = context ? context : Verilated::threadContextp();
   sig_clk_ = sig_clk;
   sig_rst_ = sig_rst;
   flags_ = flags;
+  // The DPI models start their threads in initial blocks, which haven't been
+  // evaluated yet.
+  model_threads_ = GetThreadCpuTimes().size();
+}
+
+void VerilatorSimCtrl::SetClockPeriod(unsigned long period) {
+  assert(period >= 2 && period % 2 == 0 && "Clock periods must be even.");
+  clk_period_ = period;
+}
+
+void VerilatorSimCtrl::AddClock(CData *sig_clk, unsigned long period,
+                                unsigned long phase) {
+  assert(sig_clk);
+  assert(period >= 2 && period % 2 == 0 && "Clock periods must be even.");
+  clocks_.push_back({sig_clk, period / 2, phase, phase});
 }
 
 std::pair<int, bool> VerilatorSimCtrl::Exec(int argc, char **argv) {
@@ -60,8 +187,9 @@ std::pair<int, bool> VerilatorSimCtrl::Exec(int argc, char **argv) {
   return std::make_pair(retcode, true);
 }
 
-static bool read_ul_arg(unsigned long *arg_val, const char *arg_name,
-                        const char *arg_text) {
+bool VerilatorSimCtrl::ParseUnsignedArg(unsigned long *arg_val,
+                                        const char *arg_name,
+                                        const char *arg_text) {
   assert(arg_val && arg_name && arg_text);
 
   bool bad_fmt = false;
@@ -107,10 +235,66 @@ static bool read_ul_arg(unsigned long *arg_val, const char *arg_name,
   return true;
 }
 
+// Parse a save-checkpoint argument of the form CYCLE,FILE.
+static bool read_checkpoint_arg(unsigned long *cycle, std::string *path,
+                                const char *arg_text) {
+  assert(cycle && path && arg_text);
+
+  std::string arg(arg_text);
+  size_t sep = arg.find(',');
+  if (sep == std::string::npos || sep + 1 == arg.size()) {
+    std::cerr << "ERROR: save-checkpoint must be in the format `CYCLE,FILE'. "
+              << "Got: `" << arg << "'.\n";
+    return false;
+  }
+
+  if (!VerilatorSimCtrl::ParseUnsignedArg(cycle, "save-checkpoint",
+                                          arg.substr(0, sep).c_str())) {
+    return false;
+  }
+  path->assign(arg.substr(sep + 1));
+  return true;
+}
+
+// Parse a trace-window argument of the form START:END.
+static bool read_window_arg(unsigned long *start, unsigned long *end,
+                            const char *arg_text) {
+  assert(start && end && arg_text);
+
+  std::string arg(arg_text);
+  size_t sep = arg.find(':');
+  if (sep == std::string::npos) {
+    std::cerr << "ERROR: trace-window must be in the format `START:END'. "
+              << "Got: `" << arg << "'.\n";
+    return false;
+  }
+
+  if (!VerilatorSimCtrl::ParseUnsignedArg(start, "trace-window",
+                                          arg.substr(0, sep).c_str()) ||
+      !VerilatorSimCtrl::ParseUnsignedArg(end, "trace-window",
+                                          arg.substr(sep + 1).c_str())) {
+    return false;
+  }
+  if (*end <= *start) {
+    std::cerr << "ERROR: trace-window must end after it starts. Got: `" << arg
+              << "'.\n";
+    return false;
+  }
+  return true;
+}
+
 bool VerilatorSimCtrl::ParseCommandArgs(int argc, char **argv, bool &exit_app) {
   const struct option long_options[] = {
       {"term-after-cycles", required_argument, nullptr, 'c'},
+      {"telemetry", required_argument, nullptr, 'T'},
+      {"telemetry-cycles", required_argument, nullptr, 'Y'},
+      {"telemetry-ms", required_argument, nullptr, 'M'},
       {"trace", optional_argument, nullptr, 't'},
+      {"trace-window", required_argument, nullptr, 'w'},
+      {"trace-last", required_argument, nullptr, 'L'},
+      {"save-checkpoint", required_argument, nullptr, 's'},
+      {"restore-checkpoint", required_argument, nullptr, 'R'},
+      {"stats-file", required_argument, nullptr, 'S'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, no_argument, nullptr, 0}};
 
@@ -139,11 +323,81 @@ bool VerilatorSimCtrl::ParseCommandArgs(int argc, char **argv, bool &exit_app) {
         }
         TraceOn();
         break;
+      case 'w':
+      case 'L':
+        if (!tracing_possible_) {
+          std::cerr << "ERROR: Tracing has not been enabled at compile time."
+                    << std::endl;
+          exit_app = true;
+          return false;
+        }
+        if (c == 'w') {
+          if (!read_window_arg(&trace_window_start_, &trace_window_end_,
+                               optarg)) {
+            exit_app = true;
+            return false;
+          }
+        } else {
+          if (!ParseUnsignedArg(&trace_ring_cycles_, "trace-last", optarg)) {
+            exit_app = true;
+            return false;
+          }
+          if (trace_ring_cycles_ == 0) {
+            std::cerr << "ERROR: trace-last must be at least 1." << std::endl;
+            exit_app = true;
+            return false;
+          }
+          TraceOn();
+        }
+        break;
       case 'c':
-        if (!read_ul_arg(&term_after_cycles_, "term-after-cycles", optarg)) {
+        if (!ParseUnsignedArg(&term_after_cycles_, "term-after-cycles",
+                              optarg)) {
+          exit_app = true;
+          return false;
+        }
+        break;
+      case 'T':
+        if (!telemetry_.Open(optarg)) {
+          exit_app = true;
+          return false;
+        }
+        break;
+      case 'Y':
+      case 'M': {
+        unsigned long interval;
+        if (!ParseUnsignedArg(&interval,
+                              c == 'Y' ? "telemetry-cycles" : "telemetry-ms",
+                              optarg)) {
+          exit_app = true;
+          return false;
+        }
+        if (c == 'Y') {
+          telemetry_.SetCycleInterval(interval);
+        } else {
+          telemetry_.SetWallclockInterval(interval);
+        }
+        break;
+      }
+      case 's':
+      case 'R':
+        if (!checkpoint_possible_) {
+          std::cerr << "ERROR: Checkpointing has not been enabled at compile "
+                       "time."
+                    << std::endl;
           exit_app = true;
           return false;
         }
+        if (c == 'R') {
+          restore_checkpoint_path_.assign(optarg);
+        } else if (!read_checkpoint_arg(&save_checkpoint_cycle_,
+                                        &save_checkpoint_path_, optarg)) {
+          exit_app = true;
+          return false;
+        }
+        break;
+      case 'S':
+        stats_file_path_.assign(optarg);
         break;
       case 'h':
         PrintHelp();
@@ -161,7 +415,17 @@ bool VerilatorSimCtrl::ParseCommandArgs(int argc, char **argv, bool &exit_app) {
   }
 
   // Pass args to verilator
-  Verilated::commandArgs(argc, argv);
+  assert(context_ && "Use SetTop() first.");
+  context_->commandArgs(argc, argv);
+
+  // Restore the checkpoint before the extensions see their arguments, so that
+  // e.g. memory initialization options are applied on top of the restored
+  // state.
+  if (!restore_checkpoint_path_.empty() &&
+      !RestoreCheckpoint(restore_checkpoint_path_)) {
+    exit_app = true;
+    return false;
+  }
 
   // Parse arguments for all registered extensions
   for (auto it = extension_array_.begin(); it != extension_array_.end(); ++it) {
@@ -197,6 +461,9 @@ void VerilatorSimCtrl::RunSimulation() {
   }
   // Print simulation speed info
   PrintStatistics();
+  if (!stats_file_path_.empty()) {
+    WriteStatistics(stats_file_path_);
+  }
   // Print helper message for tracing
   if (TracingEverEnabled()) {
     std::cout << std::endl
@@ -222,12 +489,114 @@ void VerilatorSimCtrl::RequestStop(bool simulation_success) {
   simulation_success_ &= simulation_success;
 }
 
+void VerilatorSimCtrl::RequestFastForward(unsigned long cycle) {
+  fast_forward_cycle_ = cycle;
+}
+
+void VerilatorSimCtrl::PrepareFork() {
+  // Finish the trace of the cycles so far. Closing the tracer also joins its
+  // writer threads, which the children wouldn't inherit.
+  if (tracer_.isOpen()) {
+    tracer_.close();
+  }
+  tracing_before_fork_ = tracing_enabled_;
+  tracing_enabled_ = false;
+  StartTracePeriod();
+
+  // Buffered output would otherwise be written once by every process.
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+}
+
+void VerilatorSimCtrl::ContinueForkedChild(const std::string &suffix) {
+  trace_file_path_ = InsertBeforeExtension(trace_file_path_, suffix);
+  trace_ring_segments_opened_ = 0;
+  tracing_enabled_ = tracing_before_fork_;
+  StartTracePeriod();
+  if (!stats_file_path_.empty()) {
+    stats_file_path_ += suffix;
+  }
+  if (!telemetry_.Reopen(suffix)) {
+    RequestStop(false);
+  }
+  // This is called from OnClock() of an extension, while the schedule is in
+  // use.
+  reschedule_extensions_ = true;
+}
+
 void VerilatorSimCtrl::RegisterExtension(SimCtrlExtension *ext) {
   extension_array_.push_back(ext);
 }
 
+bool VerilatorSimCtrl::SaveCheckpoint(const std::string &path) {
+  assert(top_ && "Use SetTop() first.");
+
+  VerilatedSave os;
+  os.open(path.c_str());
+  if (!os.isOpen()) {
+    std::cerr << "ERROR: Unable to open checkpoint file `" << path
+              << "' for writing." << std::endl;
+    return false;
+  }
+
+  // Verilator's serialization operators only accept lvalues.
+  vluint64_t time = time_;
+  vluint64_t num_extensions = extension_array_.size();
+  top_->save(os);
+  os << time;
+  os << num_extensions;
+  for (auto it = extension_array_.begin(); it != extension_array_.end(); ++it) {
+    (*it)->SaveCheckpoint(os);
+  }
+  os.close();
+
+  std::cout << "Saved checkpoint at cycle " << GetCycle() << " to " << path
+            << std::endl;
+  return true;
+}
+
+bool VerilatorSimCtrl::RestoreCheckpoint(const std::string &path) {
+  assert(top_ && "Use SetTop() first.");
+
+  VerilatedRestore is;
+  is.open(path.c_str());
+  if (!is.isOpen()) {
+    std::cerr << "ERROR: Unable to open checkpoint file `" << path
+              << "' for reading." << std::endl;
+    return false;
+  }
+
+  vluint64_t time, num_extensions;
+  top_->restore(is);
+  is >> time;
+  is >> num_extensions;
+  if (num_extensions != extension_array_.size()) {
+    std::cerr << "ERROR: Checkpoint `" << path << "' was saved with "
+              << num_extensions << " extensions, but "
+              << extension_array_.size() << " are registered." << std::endl;
+    return false;
+  }
+  for (auto it = extension_array_.begin(); it != extension_array_.end(); ++it) {
+    (*it)->RestoreCheckpoint(is);
+  }
+  is.close();
+
+  time_ = time;
+  time_restored_ = time;
+  context_->time(time_);
+  checkpoint_restored_ = true;
+
+  std::cout << "Restored checkpoint of cycle " << GetCycle() << " from "
+            << path << std::endl;
+  return true;
+}
+
 VerilatorSimCtrl::VerilatorSimCtrl()
     : top_(nullptr),
+      context_(nullptr),
+      clk_period_(2),
+      num_evals_(0),
       time_(0),
 #ifdef VM_TRACE_FMT_FST
       trace_file_path_("sim.fst"),
@@ -238,12 +607,35 @@ VerilatorSimCtrl::VerilatorSimCtrl()
       tracing_enabled_changed_(false),
       tracing_ever_enabled_(false),
       tracing_possible_(VM_TRACE),
+      tracing_before_fork_(false),
+      trace_window_start_(0),
+      trace_window_end_(0),
+      trace_ring_cycles_(0),
+      trace_ring_segment_(1),
+      trace_ring_segment_end_(0),
+      trace_ring_segments_opened_(0),
+      trace_triggered_(false),
+      trace_period_enabled_(false),
+      trace_period_begin_time_(0),
+      trace_period_begin_skipped_cycles_(0),
+      traced_cycles_(0),
+      untraced_cycles_(0),
+      traced_duration_(0),
+      untraced_duration_(0),
+      checkpoint_possible_(CHECKPOINT_POSSIBLE),
+      save_checkpoint_cycle_(0),
+      checkpoint_restored_(false),
+      time_restored_(0),
       initial_reset_delay_cycles_(2),
       reset_duration_cycles_(2),
       request_stop_(false),
       simulation_success_(true),
+      model_threads_(0),
       tracer_(VerilatedTracer()),
-      term_after_cycles_(0) {
+      term_after_cycles_(0),
+      fast_forward_cycle_(0),
+      skipped_cycles_(0),
+      reschedule_extensions_(false) {
 }
 
 void VerilatorSimCtrl::RegisterSignalHandler() {
@@ -279,10 +671,33 @@ void VerilatorSimCtrl::PrintHelp() const {
   if (tracing_possible_) {
     std::cout << "-t|--trace\n"
                  "   --trace=FILE\n"
-                 "  Write a trace file from the start\n\n";
+                 "  Write a trace file from the start\n\n"
+                 "--trace-window=START:END\n"
+                 "  Trace from cycle START until (excluding) cycle END\n\n"
+                 "--trace-last=N\n"
+                 "  Trace into a ring buffer holding at least the last N\n"
+                 "  cycles, which is only kept if the simulation fails or\n"
+                 "  the capture is triggered by simctrl_trace_trigger()\n\n";
+  }
+  if (checkpoint_possible_) {
+    std::cout << "--save-checkpoint=CYCLE,FILE\n"
+                 "  Save the simulation state to FILE when reaching CYCLE\n\n"
+                 "--restore-checkpoint=FILE\n"
+                 "  Continue the simulation from the state saved in FILE\n\n";
   }
   std::cout << "-c|--term-after-cycles=N\n"
                "  Terminate simulation after N cycles. 0 means no timeout.\n\n"
+               "--telemetry=FILE\n"
+               "--telemetry=unix:PATH\n"
+               "  Periodically write performance reports as JSON lines to\n"
+               "  FILE or to the Unix domain socket at PATH\n\n"
+               "--telemetry-cycles=N\n"
+               "  Write a performance report every N cycles\n\n"
+               "--telemetry-ms=N\n"
+               "  Write a performance report every N ms of wallclock time\n"
+               "  (default: every 10 s if no interval is given)\n\n"
+               "--stats-file=FILE\n"
+               "  Write the simulation statistics as JSON to FILE\n\n"
                "-h|--help\n"
                "  Show help\n\n"
                "All arguments are passed to the design and can be used "
@@ -301,6 +716,15 @@ bool VerilatorSimCtrl::TraceOn() {
   return tracing_enabled_;
 }
 
+void VerilatorSimCtrl::TraceTrigger() {
+  trace_triggered_ = true;
+  if (trace_ring_cycles_) {
+    TraceOff();
+  } else {
+    TraceOn();
+  }
+}
+
 bool VerilatorSimCtrl::TraceOff() {
   if (tracing_enabled_) {
     tracing_enabled_changed_ = true;
@@ -309,29 +733,203 @@ bool VerilatorSimCtrl::TraceOff() {
   return tracing_enabled_;
 }
 
+unsigned long VerilatorSimCtrl::GetEvaluatedCycles() const {
+  return (time_ - time_restored_) / clk_period_ - skipped_cycles_;
+}
+
+// Get the peak resident set size of the simulation process in KiB, or 0 if it
+// is unknown.
+static long GetPeakRssKiB() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // Linux reports ru_maxrss in KiB
+  return usage.ru_maxrss;
+}
+
 void VerilatorSimCtrl::PrintStatistics() const {
-  double speed_hz = time_ / 2 / (GetExecutionTimeMs() / 1000.0);
+  // Skipped cycles are reported separately and don't count towards the speed
+  double speed_hz = GetEvaluatedCycles() / (GetExecutionTimeMs() / 1000.0);
   double speed_khz = speed_hz / 1000.0;
 
   std::cout << std::endl
             << "Simulation statistics" << std::endl
             << "=====================" << std::endl
-            << "Executed cycles:  " << std::dec << time_ / 2 << std::endl
-            << "Wallclock time:   " << GetExecutionTimeMs() / 1000.0 << " s"
+            << "Executed cycles:  " << std::dec << GetCycle() << std::endl;
+  if (skipped_cycles_) {
+    std::cout << "Skipped cycles:   " << skipped_cycles_ << std::endl;
+  }
+  if (!clocks_.empty()) {
+    std::cout << "Evaluations:      " << num_evals_ << std::endl;
+  }
+  std::cout << "Wallclock time:   " << GetExecutionTimeMs() / 1000.0 << " s"
             << std::endl
             << "Simulation speed: " << speed_hz << " cycles/s "
             << "(" << speed_khz << " kHz)" << std::endl;
 
+  long peak_rss_kib = GetPeakRssKiB();
+  if (peak_rss_kib) {
+    std::cout << "Peak memory:      " << peak_rss_kib / 1024 << " MiB"
+              << std::endl;
+  }
+
   int trace_size_byte;
   if (tracing_enabled_ && FileSize(GetTraceFileName(), trace_size_byte)) {
     std::cout << "Trace file size:  " << trace_size_byte << " B" << std::endl;
   }
+
+  // Compare the speed with and without tracing if both have been seen
+  double traced_s = std::chrono::duration<double>(traced_duration_).count();
+  double untraced_s = std::chrono::duration<double>(untraced_duration_).count();
+  if (traced_cycles_ && untraced_cycles_ && traced_s > 0 && untraced_s > 0) {
+    double traced_speed_hz = traced_cycles_ / traced_s;
+    double untraced_speed_hz = untraced_cycles_ / untraced_s;
+    std::cout << "Speed (traced):   " << traced_speed_hz << " cycles/s"
+              << std::endl
+              << "Speed (untraced): " << untraced_speed_hz << " cycles/s"
+              << std::endl
+              << "Tracing slowdown: " << untraced_speed_hz / traced_speed_hz
+              << "x" << std::endl;
+  }
+
+  PrintThreadStatistics();
+}
+
+bool VerilatorSimCtrl::WriteStatistics(const std::string &path) const {
+  std::ofstream stats_file(path);
+  if (!stats_file) {
+    std::cerr << "ERROR: Unable to open statistics file `" << path
+              << "' for writing." << std::endl;
+    return false;
+  }
+
+  double wallclock_s = GetExecutionTimeMs() / 1000.0;
+  unsigned long evaluated_cycles = GetEvaluatedCycles();
+  double speed_hz = wallclock_s > 0 ? evaluated_cycles / wallclock_s : 0;
+
+  stats_file << "{\"name\":\"" << GetName() << "\""
+             << ",\"cycles\":" << GetCycle()
+             << ",\"evaluated_cycles\":" << evaluated_cycles
+             << ",\"skipped_cycles\":" << skipped_cycles_
+             << ",\"wallclock_s\":" << wallclock_s
+             << ",\"cycles_per_s\":" << speed_hz
+             << ",\"peak_rss_kib\":" << GetPeakRssKiB()
+             << ",\"success\":" << (simulation_success_ ? "true" : "false")
+             << "}" << std::endl;
+  if (!stats_file) {
+    std::cerr << "ERROR: Unable to write statistics file `" << path << "'."
+              << std::endl;
+    return false;
+  }
+  std::cout << "Statistics written to " << path << std::endl;
+  return true;
+}
+
+void VerilatorSimCtrl::PrintThreadStatistics() const {
+  // Only threads which existed for the whole run are reported. Verilator
+  // creates its worker threads when the model is constructed.
+  std::vector<std::pair<long, double>> thread_cpu_times;
+  for (const auto &end : thread_cpu_time_end_) {
+    auto begin = thread_cpu_time_begin_.find(end.first);
+    if (begin == thread_cpu_time_begin_.end()) {
+      continue;
+    }
+    thread_cpu_times.emplace_back(end.first, end.second - begin->second);
+  }
+
+  if (thread_cpu_times.size() < 2) {
+    return;
+  }
+
+  double wallclock_s = GetExecutionTimeMs() / 1000.0;
+  if (wallclock_s <= 0) {
+    return;
+  }
+
+  // Format into a local stream to leave the flags of std::cout untouched
+  std::ostringstream oss;
+  oss << std::endl << "Thread utilisation:" << std::endl;
+  double total_cpu_s = 0;
+  for (const auto &thread_cpu_time : thread_cpu_times) {
+    double utilisation = thread_cpu_time.second / wallclock_s;
+    total_cpu_s += thread_cpu_time.second;
+    oss << "  Thread " << std::setw(8) << thread_cpu_time.first << ": "
+        << std::fixed << std::setprecision(1) << std::setw(5)
+        << 100.0 * utilisation << " % (" << std::setprecision(2)
+        << thread_cpu_time.second << " s CPU time)" << std::endl;
+  }
+  oss << "  Total:           " << std::setprecision(2)
+      << total_cpu_s / wallclock_s << " CPUs busy on average" << std::endl;
+  std::cout << oss.str();
 }
 
 std::string VerilatorSimCtrl::GetTraceFileName() const {
+  if (trace_ring_cycles_) {
+    return GetTraceRingFileName(trace_ring_segment_);
+  }
   return trace_file_path_;
 }
 
+std::string VerilatorSimCtrl::GetTraceRingFileName(unsigned int segment) const {
+  return InsertBeforeExtension(trace_file_path_, "." + std::to_string(segment));
+}
+
+void VerilatorSimCtrl::StartTracePeriod() {
+  auto now = std::chrono::steady_clock::now();
+  unsigned long cycles =
+      (time_ - trace_period_begin_time_) / clk_period_ -
+      (skipped_cycles_ - trace_period_begin_skipped_cycles_);
+
+  if (trace_period_enabled_) {
+    traced_cycles_ += cycles;
+    traced_duration_ += now - trace_period_begin_;
+  } else {
+    untraced_cycles_ += cycles;
+    untraced_duration_ += now - trace_period_begin_;
+  }
+
+  trace_period_enabled_ = TracingEnabled();
+  trace_period_begin_ = now;
+  trace_period_begin_time_ = time_;
+  trace_period_begin_skipped_cycles_ = skipped_cycles_;
+}
+
+void VerilatorSimCtrl::FinishTraceRing() {
+  // The second segment is only written once the first one is full, and none
+  // is written if tracing never started. Files of the same name left over
+  // from earlier simulations aren't part of this ring buffer.
+  std::vector<std::string> segments;
+  for (unsigned int segment = 0; segment < 2; ++segment) {
+    if (trace_ring_segments_opened_ & (1 << segment)) {
+      segments.push_back(GetTraceRingFileName(segment));
+    }
+  }
+  if (segments.empty()) {
+    tracing_ever_enabled_ = false;
+    return;
+  }
+
+  if (simulation_success_ && !trace_triggered_) {
+    std::cout << "Simulation successful, discarding trace ring buffer."
+              << std::endl;
+    for (const std::string &segment : segments) {
+      unlink(segment.c_str());
+    }
+    // Nothing left to view
+    tracing_ever_enabled_ = false;
+    return;
+  }
+
+  if (segments.size() == 1) {
+    std::cout << "Trace ring buffer kept in " << segments[0] << std::endl;
+    return;
+  }
+  std::cout << "Trace ring buffer kept in " << segments[0] << " and "
+            << segments[1] << ", the latest cycles are in "
+            << GetTraceFileName() << std::endl;
+}
+
 void VerilatorSimCtrl::Run() {
   assert(top_ && "Use SetTop() first.");
 
@@ -341,21 +939,55 @@ void VerilatorSimCtrl::Run() {
     top_->trace(tracer_, 99, 0);
   }
 
-  // Evaluate all initial blocks, including the DPI setup routines
-  top_->eval();
+  // Evaluate all initial blocks, including the DPI setup routines. A restored
+  // model has already been through this.
+  if (!checkpoint_restored_) {
+    top_->eval();
+  }
 
   std::cout << std::endl
             << "Simulation running, end by pressing CTRL-c." << std::endl;
 
   time_begin_ = std::chrono::steady_clock::now();
-  UnsetReset();
+  thread_cpu_time_begin_ = GetThreadCpuTimes();
+  trace_period_begin_ = time_begin_;
+  trace_period_begin_time_ = time_;
+  trace_period_enabled_ = TracingEnabled();
+  if (!checkpoint_restored_) {
+    UnsetReset();
+  }
   Trace();
 
+  ScheduleClocks();
+  ScheduleExtensions();
+  telemetry_.Start(GetName(), GetCycle());
+
   unsigned long start_reset_cycle_ = initial_reset_delay_cycles_;
   unsigned long end_reset_cycle_ = start_reset_cycle_ + reset_duration_cycles_;
 
   while (1) {
-    unsigned long cycle_ = time_ / 2;
+    if (fast_forward_cycle_ > GetCycle() && time_ % clk_period_ == 0) {
+      FastForward({start_reset_cycle_, end_reset_cycle_, term_after_cycles_,
+                   save_checkpoint_path_.empty() ? 0 : save_checkpoint_cycle_,
+                   trace_window_start_, trace_window_end_});
+    }
+
+    unsigned long cycle_ = GetCycle();
+
+    if (trace_window_end_ && time_ % clk_period_ == 0) {
+      if (cycle_ == trace_window_start_) {
+        TraceOn();
+      } else if (cycle_ == trace_window_end_) {
+        TraceOff();
+      }
+    }
+
+    if (!save_checkpoint_path_.empty() &&
+        time_ == clk_period_ * save_checkpoint_cycle_) {
+      if (!SaveCheckpoint(save_checkpoint_path_)) {
+        RequestStop(false);
+      }
+    }
 
     if (cycle_ == start_reset_cycle_) {
       SetReset();
@@ -363,18 +995,20 @@ void VerilatorSimCtrl::Run() {
       UnsetReset();
     }
 
-    *sig_clk_ = !*sig_clk_;
+    bool clk_rising = ToggleClocks();
 
     // Call all extension on-clock methods
-    if (*sig_clk_) {
-      for (auto it = extension_array_.begin(); it != extension_array_.end();
-           ++it) {
-        (*it)->OnClock(time_);
-      }
+    if (clk_rising && extension_schedule_.IsDue(cycle_)) {
+      ClockExtensions();
     }
 
+    telemetry_.BeginEval();
     top_->eval();
-    time_++;
+    telemetry_.EndEval();
+    num_evals_++;
+    time_ = GetNextClockEdge();
+    context_->time(time_);
+    telemetry_.OnCycle(GetCycle());
 
     Trace();
 
@@ -383,12 +1017,12 @@ void VerilatorSimCtrl::Run() {
                 << std::endl;
       break;
     }
-    if (Verilated::gotFinish()) {
+    if (context_->gotFinish()) {
       std::cout << "Received $finish() from Verilog, shutting down simulation."
                 << std::endl;
       break;
     }
-    if (term_after_cycles_ && (time_ / 2 >= term_after_cycles_)) {
+    if (term_after_cycles_ && (GetCycle() >= term_after_cycles_)) {
       std::cout << "Simulation timeout of " << term_after_cycles_
                 << " cycles reached, shutting down simulation." << std::endl;
       break;
@@ -397,10 +1031,16 @@ void VerilatorSimCtrl::Run() {
 
   top_->final();
   time_end_ = std::chrono::steady_clock::now();
+  telemetry_.Finish(GetCycle());
+  thread_cpu_time_end_ = GetThreadCpuTimes();
+  StartTracePeriod();
 
-  if (TracingEverEnabled()) {
+  if (tracer_.isOpen()) {
     tracer_.close();
   }
+  if (trace_ring_cycles_) {
+    FinishTraceRing();
+  }
 }
 
 std::string VerilatorSimCtrl::GetName() const {
@@ -443,11 +1083,100 @@ bool VerilatorSimCtrl::FileSize(std::string filepath, int &size_byte) const {
   return true;
 }
 
+void VerilatorSimCtrl::ScheduleClocks() {
+  for (auto &clock : clocks_) {
+    clock.next_edge = clock.phase;
+    if (time_ > clock.phase) {
+      unsigned long edges =
+          (time_ - clock.phase + clock.half_period - 1) / clock.half_period;
+      clock.next_edge += edges * clock.half_period;
+    }
+  }
+}
+
+bool VerilatorSimCtrl::ToggleClocks() {
+  bool clk_rising = false;
+  if (time_ % (clk_period_ / 2) == 0) {
+    *sig_clk_ = !*sig_clk_;
+    clk_rising = *sig_clk_;
+  }
+
+  for (auto &clock : clocks_) {
+    if (clock.next_edge == time_) {
+      *clock.sig = !*clock.sig;
+      clock.next_edge += clock.half_period;
+    }
+  }
+  return clk_rising;
+}
+
+unsigned long VerilatorSimCtrl::GetNextClockEdge() const {
+  unsigned long half_period = clk_period_ / 2;
+  unsigned long next_edge = (time_ / half_period + 1) * half_period;
+
+  for (const auto &clock : clocks_) {
+    next_edge = std::min(next_edge, clock.next_edge);
+  }
+  return next_edge;
+}
+
+void VerilatorSimCtrl::ScheduleExtensions() {
+  extension_schedule_.Reset(extension_array_, GetCycle());
+}
+
+void VerilatorSimCtrl::ClockExtensions() {
+  telemetry_.BeginExtensions();
+  extension_schedule_.Clock(GetCycle(), time_);
+  if (reschedule_extensions_) {
+    reschedule_extensions_ = false;
+    extension_schedule_.Reset(extension_array_, GetCycle() + 1);
+  }
+  telemetry_.EndExtensions();
+}
+
+void VerilatorSimCtrl::FastForward(
+    std::initializer_list<unsigned long> events) {
+  assert(time_ % clk_period_ == 0);
+
+  unsigned long cycle = GetCycle();
+  unsigned long target = fast_forward_cycle_;
+  for (unsigned long event : events) {
+    if (event > cycle) {
+      target = std::min(target, event);
+    }
+  }
+  target = std::min(target, extension_schedule_.GetSkipLimit(cycle));
+
+  if (target <= cycle) {
+    return;
+  }
+
+  skipped_cycles_ += target - cycle;
+  time_ = clk_period_ * target;
+  context_->time(time_);
+
+  // The clock passed to SetTop() has the same state at the start of every
+  // cycle. Other clocks end up in the state they would have had after all
+  // skipped edges.
+  for (auto &clock : clocks_) {
+    if (clock.next_edge >= time_) {
+      continue;
+    }
+    unsigned long skipped_edges =
+        (time_ - clock.next_edge + clock.half_period - 1) / clock.half_period;
+    if (skipped_edges % 2) {
+      *clock.sig = !*clock.sig;
+    }
+    clock.next_edge += skipped_edges * clock.half_period;
+  }
+}
+
 void VerilatorSimCtrl::Trace() {
   // We cannot output a message when calling TraceOn()/TraceOff() as these
   // functions can be called from a signal handler. Instead we print the message
   // here from the main loop.
   if (tracing_enabled_changed_) {
+    StartTracePeriod();
     if (TracingEnabled()) {
       std::cout << "Tracing enabled." << std::endl;
     } else {
@@ -460,10 +1189,24 @@ void VerilatorSimCtrl::Trace() {
     return;
   }
 
+  // Switch to the other segment of the trace ring buffer, overwriting the
+  // oldest cycles
+  if (trace_ring_cycles_ && GetCycle() >= trace_ring_segment_end_) {
+    if (tracer_.isOpen()) {
+      tracer_.close();
+    }
+    trace_ring_segment_ ^= 1;
+    trace_ring_segment_end_ = GetCycle() + trace_ring_cycles_;
+  }
+
   if (!tracer_.isOpen()) {
     tracer_.open(GetTraceFileName().c_str());
-    std::cout << "Writing simulation traces to " << GetTraceFileName()
-              << std::endl;
+    if (trace_ring_cycles_) {
+      trace_ring_segments_opened_ |= 1 << trace_ring_segment_;
+    } else {
+      std::cout << "Writing simulation traces to " << GetTraceFileName()
+                << std::endl;
+    }
   }
 
   tracer_.dump(GetTime());
@@ -6,10 +6,13 @@
 #define OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_VERILATOR_SIM_CTRL_H_
 
 #include <chrono>
+#include <map>
 #include <string>
 #include <vector>
 
 #include "sim_ctrl_extension.h"
+#include "sim_ctrl_extension_schedule.h"
+#include "sim_ctrl_telemetry.h"
 #include "verilated_toplevel.h"
 
 enum VerilatorSimCtrlFlags {
@@ -34,9 +37,37 @@ class VerilatorSimCtrl {
 
   /**
    * Set the top-level design
+   *
+   * @param context Verilator context the model was constructed in. If not
+   *                given, the default (thread-local) context is used, which is
+   *                the one a model constructed without a context lives in.
    */
   void SetTop(VerilatedToplevel *top, CData *sig_clk, CData *sig_rst,
-              VerilatorSimCtrlFlags flags = Defaults);
+              VerilatorSimCtrlFlags flags = Defaults,
+              VerilatedContext *context = nullptr);
+
+  /**
+   * Set the period of the clock passed to SetTop() in ticks
+   *
+   * Ticks are the time unit of the simulation (see GetTime()). The period must
+   * be even and defaults to 2 ticks, i.e. the clock toggles every tick. Use
+   * longer periods to add clocks with other frequencies with AddClock().
+   */
+  void SetClockPeriod(unsigned long period);
+
+  /**
+   * Add a further clock to the simulation
+   *
+   * The clock toggles every period / 2 ticks, the first time at tick |phase|.
+   * The design is only evaluated at ticks in which at least one clock toggles.
+   * Clock cycles, e.g. for the reset and the timeout, are always counted on
+   * the clock passed to SetTop().
+   *
+   * @param sig_clk Clock signal
+   * @param period Clock period in ticks, must be even
+   * @param phase Tick of the first clock edge
+   */
+  void AddClock(CData *sig_clk, unsigned long period, unsigned long phase = 0);
 
   /**
    * Setup and run the simulation (all in one)
@@ -111,6 +142,55 @@ class VerilatorSimCtrl {
    */
   void RequestStop(bool simulation_success);
 
+  /**
+   * Request the simulation to fast-forward to a clock cycle
+   *
+   * Use this function to skip over periods in which the design is known to be
+   * idle, e.g. while the CPU waits for an interrupt. The skipped cycles are
+   * neither evaluated nor passed to the extensions. The simulation stops
+   * skipping early at cycles in which the reset changes, the timeout expires,
+   * a checkpoint is saved, or an extension needs to be called (see
+   * SimCtrlExtension::GetNextActiveCycle()).
+   *
+   * Cycles are skipped from the next clock cycle on. Requesting a cycle in the
+   * past cancels a previous request. SystemVerilog code can request skipping
+   * through the simctrl_fast_forward() DPI function.
+   */
+  void RequestFastForward(unsigned long cycle);
+
+  /**
+   * Enable tracing (if possible)
+   *
+   * Enabling tracing can fail if no tracing support has been compiled into the
+   * simulation.
+   *
+   * This function can be called from a signal handler.
+   *
+   * @return Is tracing enabled?
+   */
+  bool TraceOn();
+
+  /**
+   * Disable tracing
+   *
+   * This function can be called from a signal handler.
+   *
+   * @return Is tracing enabled?
+   */
+  bool TraceOff();
+
+  /**
+   * Trigger the waveform capture
+   *
+   * If the trace ring buffer is used (--trace-last), tracing stops and the
+   * captured cycles leading up to the trigger are kept, even if the simulation
+   * succeeds. Otherwise, tracing is enabled.
+   *
+   * This function is also available to SystemVerilog code through the
+   * simctrl_trace_trigger() DPI function.
+   */
+  void TraceTrigger();
+
   /**
    * Register an extension to be called automatically
    */
@@ -121,10 +201,86 @@ class VerilatorSimCtrl {
    */
   unsigned long GetTime() const { return time_; }
 
+  /**
+   * Get the current clock cycle of the clock passed to SetTop()
+   */
+  unsigned long GetCycle() const { return time_ / clk_period_; }
+
+  /**
+   * Get the Verilator context driven by this simulation controller
+   */
+  VerilatedContext *GetContext() const { return context_; }
+
+  /**
+   * Get the number of threads running the model
+   *
+   * This is the number of threads of the process when the model was passed to
+   * SetTop(): the main thread and the worker threads of a model verilated with
+   * --threads. Threads started later, e.g. by DPI models or to write traces,
+   * are not included. Returns 0 if unknown.
+   */
+  unsigned GetModelThreads() const { return model_threads_; }
+
+  /**
+   * Prepare the simulation for a fork() of the process
+   *
+   * Flushes all buffered output and closes the trace file, which also stops
+   * the threads writing FST traces. The parent process doesn't trace any
+   * further cycles, call ContinueForkedChild() in each child process to
+   * continue tracing there.
+   *
+   * Only models running on a single thread (see GetModelThreads()) can be
+   * forked: fork() doesn't duplicate any other threads.
+   */
+  void PrepareFork();
+
+  /**
+   * Give a process created after PrepareFork() its own output files
+   *
+   * Inserts |suffix| into the names of the trace file(s) before the extension,
+   * appends it to the name of the statistics file, and reopens the telemetry
+   * destination (see SimCtrlTelemetry::Reopen()). The clock dividers of all
+   * extensions are queried again after the current cycle, as forking usually
+   * changes which extensions need OnClock() calls.
+   *
+   * Sockets, PTYs and files opened by DPI models are still shared with the
+   * parent and all other children.
+   */
+  void ContinueForkedChild(const std::string &suffix);
+
+  /**
+   * Parse an unsigned integer command-line argument
+   *
+   * Accepts decimal, octal and hexadecimal numbers without leading whitespace
+   * or signs.
+   *
+   * @param arg_val Parsed value
+   * @param arg_name Name of the argument for error messages
+   * @param arg_text Text to parse
+   * @return Return code, true == success. On failure, an error message is
+   *         written to stderr.
+   */
+  static bool ParseUnsignedArg(unsigned long *arg_val, const char *arg_name,
+                               const char *arg_text);
+
  private:
   VerilatedToplevel *top_;
+  VerilatedContext *context_;
   CData *sig_clk_;
   CData *sig_rst_;
+  unsigned long clk_period_;
+
+  /**
+   * A clock added with AddClock()
+   */
+  struct SimClock {
+    CData *sig;
+    unsigned long half_period;
+    unsigned long phase;
+    unsigned long next_edge;
+  };
+  std::vector<SimClock> clocks_;
+  unsigned long num_evals_;
   VerilatorSimCtrlFlags flags_;
   unsigned long time_;
   std::string trace_file_path_;
@@ -132,15 +288,53 @@ class VerilatorSimCtrl {
   bool tracing_enabled_changed_;
   bool tracing_ever_enabled_;
   bool tracing_possible_;
+  bool tracing_before_fork_;
+  unsigned long trace_window_start_;
+  unsigned long trace_window_end_;
+  unsigned long trace_ring_cycles_;
+  unsigned int trace_ring_segment_;
+  unsigned long trace_ring_segment_end_;
+  // Bit mask of the segments of the trace ring buffer written so far
+  unsigned int trace_ring_segments_opened_;
+  bool trace_triggered_;
+
+  // Simulation speed with and without tracing. The current period of constant
+  // tracing state started at trace_period_begin_, when the simulation time was
+  // trace_period_begin_time_.
+  bool trace_period_enabled_;
+  std::chrono::steady_clock::time_point trace_period_begin_;
+  unsigned long trace_period_begin_time_;
+  unsigned long trace_period_begin_skipped_cycles_;
+  unsigned long traced_cycles_;
+  unsigned long untraced_cycles_;
+  std::chrono::steady_clock::duration traced_duration_;
+  std::chrono::steady_clock::duration untraced_duration_;
+  bool checkpoint_possible_;
+  std::string save_checkpoint_path_;
+  unsigned long save_checkpoint_cycle_;
+  std::string restore_checkpoint_path_;
+  bool checkpoint_restored_;
+  unsigned long time_restored_;
   unsigned int initial_reset_delay_cycles_;
   unsigned int reset_duration_cycles_;
   volatile unsigned int request_stop_;
   volatile bool simulation_success_;
   std::chrono::steady_clock::time_point time_begin_;
   std::chrono::steady_clock::time_point time_end_;
+  std::map<long, double> thread_cpu_time_begin_;
+  std::map<long, double> thread_cpu_time_end_;
+  unsigned model_threads_;
   VerilatedTracer tracer_;
   unsigned long term_after_cycles_;
+  SimCtrlTelemetry telemetry_;
+  std::string stats_file_path_;
+  unsigned long fast_forward_cycle_;
+  unsigned long skipped_cycles_;
   std::vector<SimCtrlExtension *> extension_array_;
+  // OnClock() calls of the extensions in extension_array_, and whether they
+  // must be scheduled again after the current cycle
+  SimCtrlExtensionSchedule extension_schedule_;
+  bool reschedule_extensions_;
 
   /**
    * Default constructor
@@ -166,23 +360,6 @@ class VerilatorSimCtrl {
    */
   void PrintHelp() const;
 
-  /**
-   * Enable tracing (if possible)
-   *
-   * Enabling tracing can fail if no tracing support has been compiled into the
-   * simulation.
-   *
-   * @return Is tracing enabled?
-   */
-  bool TraceOn();
-
-  /**
-   * Disable tracing
-   *
-   * @return Is tracing enabled?
-   */
-  bool TraceOff();
-
   /**
    * Is tracing currently enabled?
    */
@@ -200,20 +377,99 @@ class VerilatorSimCtrl {
    */
   bool TracingPossible() const { return tracing_possible_; }
 
+  /**
+   * Is checkpointing support compiled into the simulation?
+   */
+  bool CheckpointPossible() const { return checkpoint_possible_; }
+
+  /**
+   * Save the simulation state into a checkpoint file
+   *
+   * The checkpoint contains the state of the Verilated model, the simulation
+   * time and the state of all registered extensions. State held by DPI code
+   * outside of the model (e.g. behind chandles) is not included, so only
+   * toplevels without DPI models which keep such state can be checkpointed.
+   *
+   * @return Return code, true == success
+   */
+  bool SaveCheckpoint(const std::string &path);
+
+  /**
+   * Restore the simulation state from a checkpoint file
+   *
+   * The checkpoint must have been written by the same simulation binary with
+   * the same set of registered extensions.
+   *
+   * @return Return code, true == success
+   */
+  bool RestoreCheckpoint(const std::string &path);
+
   /**
    * Print statistics about the simulation run
    */
   void PrintStatistics() const;
 
+  /**
+   * Write the statistics of the simulation run as JSON object to a file
+   *
+   * The file is meant to be consumed by benchmarking scripts, e.g.
+   *
+   *   {"name":"chip_sim_tb","cycles":2000000,"evaluated_cycles":2000000,
+   *    "skipped_cycles":0,"wallclock_s":25.1,"cycles_per_s":79681.3,
+   *    "peak_rss_kib":412345,"success":true}
+   *
+   * @return Return code, true == success
+   */
+  bool WriteStatistics(const std::string &path) const;
+
+  /**
+   * Get the number of clock cycles the model was evaluated for in this run
+   *
+   * Cycles skipped by fast-forwarding or restored from a checkpoint are not
+   * included.
+   */
+  unsigned long GetEvaluatedCycles() const;
+
+  /**
+   * Print the CPU utilisation of each thread of the simulation process
+   *
+   * For models verilated with --threads, this shows how well the evaluation
+   * is spread across the worker threads.
+   */
+  void PrintThreadStatistics() const;
+
   /**
    * Get the file name of the trace file
+   *
+   * If the trace ring buffer is used, this is the currently written segment.
    */
   std::string GetTraceFileName() const;
 
+  /**
+   * Get the file name of a segment of the trace ring buffer
+   */
+  std::string GetTraceRingFileName(unsigned int segment) const;
+
+  /**
+   * Account the cycles and time since the last change of the tracing state
+   * to the traced or untraced simulation speed, and start a new period
+   */
+  void StartTracePeriod();
+
+  /**
+   * Keep or discard the trace ring buffer at the end of the simulation
+   *
+   * The captured trace is only kept if the simulation failed or the capture
+   * was triggered.
+   */
+  void FinishTraceRing();
+
   /**
    * Run the main loop of the simulation
    *
-   * This function blocks until the simulation finishes.
+   * This function blocks until the simulation finishes. Extensions are always
+   * called from the thread running this function, even if the model itself
+   * distributes its evaluation across multiple threads.
    */
   void Run();
 
@@ -244,6 +500,43 @@ class VerilatorSimCtrl {
    */
   bool FileSize(std::string filepath, int &size_byte) const;
 
+  /**
+   * Compute the next edge of all clocks added with AddClock() at or after
+   * the current time
+   */
+  void ScheduleClocks();
+
+  /**
+   * Toggle all clocks with an edge at the current time
+   *
+   * @return Did the clock passed to SetTop() rise?
+   */
+  bool ToggleClocks();
+
+  /**
+   * Get the time of the next edge of any clock after the current time
+   */
+  unsigned long GetNextClockEdge() const;
+
+  /**
+   * Set up the OnClock() schedule of all registered extensions
+   */
+  void ScheduleExtensions();
+
+  /**
+   * Call OnClock() of all extensions which are due in the current cycle
+   */
+  void ClockExtensions();
+
+  /**
+   * Skip cycles as requested through RequestFastForward()
+   *
+   * Must be called between two clock cycles.
+   *
+   * @param events Cycles of upcoming events of the simulation controller
+   */
+  void FastForward(std::initializer_list<unsigned long> events);
+
   /**
    * Perform tracing in Verilator if required
    */
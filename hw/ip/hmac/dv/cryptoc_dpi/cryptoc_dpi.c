@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "hmac.h"
 #include "hmac_wrap.h"
@@ -17,6 +18,49 @@
 // SystemVerilog DPI definitions
 #include "svdpi.h"
 
+// Message bytes are gathered from open arrays into a buffer of this size
+// before being passed to the hash functions.
+#define CHUNK_LEN 1024
+
+// State of an incremental hash or HMAC computation started from SV with one of
+// the c_dpi_*_init() functions. Message bytes are added with
+// c_dpi_hash_update() and c_dpi_hash_final() returns the digest and frees the
+// state.
+typedef enum { kDpiHash, kDpiHmacLite, kDpiHmac } dpi_hash_kind_t;
+
+typedef struct dpi_hash_ctx {
+  dpi_hash_kind_t kind;
+  // The hash context comes first in each of these, so hash.f and
+  // HASH_update(&hash, ...) are valid whatever the kind.
+  union {
+    HASH_CTX hash;
+    LITE_HMAC_CTX lite_hmac;
+    HMAC_CTX hmac;
+  } u;
+} dpi_hash_ctx_t;
+
+// Gather len elements of the open array, starting with element offset, into
+// a C-style array of contiguous bytes
+static void gather_bytes(const svOpenArrayHandle arg, uint64_t offset,
+                         uint8_t *arr, uint64_t len) {
+  const svBitVecVal *ptr = (svBitVecVal *)svGetArrayPtr(arg);
+  if (ptr) {
+    // C-style layout
+    for (uint64_t idx = 0u; idx < len; ++idx) {
+      arr[idx] = (uint8_t)ptr[offset + idx];
+    }
+  } else {
+    // The implementation-independent way to access open arrays is to use the
+    // SystemVerilog array bounds/indexes.
+    const int low = svLow(arg, 1);
+    for (uint64_t idx = 0u; idx < len; ++idx) {
+      uint8_t *elem = (uint8_t *)svGetArrElemPtr1(arg, low + offset + idx);
+      assert(elem);
+      arr[idx] = *elem;
+    }
+  }
+}
+
 // Gather the elements of the open array to form a C-style array of contiguous
 // bytes
 static uint8_t *collect_bytes(const svOpenArrayHandle arg, uint64_t len) {
@@ -30,171 +74,226 @@ static uint8_t *collect_bytes(const svOpenArrayHandle arg, uint64_t len) {
 
   uint8_t *arr = (uint8_t *)malloc(len);
   if (arr) {
-    const svBitVecVal *ptr = (svBitVecVal *)svGetArrayPtr(arg);
-    if (ptr) {
-      // C-style layout
-      for (uint64_t idx = 0u; idx < len; ++idx) {
-        arr[idx] = (uint8_t)ptr[idx];
-      }
-    } else {
-      // The implementation-independent way to access open arrays is to use the
-      // SystemVerilog array bounds/indexes.
-      const int high = svHigh(arg, 1);
-      const int low = svLow(arg, 1);
-
-      printf("bounds [%d:%d]\n", high, low);
-
-      for (int idx = low; idx <= high; ++idx) {
-        uint8_t *ptr = (uint8_t *)svGetArrElemPtr1(arg, idx);
-        assert(ptr);
-        arr[idx] = (uint8_t)*ptr;
-      }
-    }
+    gather_bytes(arg, 0u, arr, len);
   }
 
   return arr;
 }
 
+// Add the first len elements of the open array to a hash, a chunk at a time,
+// so that the message is never copied as a whole
+static void update_from_array(HASH_CTX *ctx, const svOpenArrayHandle arg,
+                              uint64_t len) {
+  // See collect_bytes() about empty arrays
+  if (len == 0u) {
+    return;
+  }
+
+  assert(1 == svDimensions(arg));
+  assert(len <= svSize(arg, 1));
+
+  uint8_t chunk[CHUNK_LEN];
+  for (uint64_t offset = 0u; offset < len;) {
+    uint64_t chunk_len = len - offset < CHUNK_LEN ? len - offset : CHUNK_LEN;
+    gather_bytes(arg, offset, chunk, chunk_len);
+    HASH_update(ctx, chunk, chunk_len);
+    offset += chunk_len;
+  }
+}
+
+static dpi_hash_ctx_t *new_hash_ctx(dpi_hash_kind_t kind) {
+  dpi_hash_ctx_t *ctx = (dpi_hash_ctx_t *)malloc(sizeof(dpi_hash_ctx_t));
+  assert(ctx);
+  ctx->kind = kind;
+  return ctx;
+}
+
+static dpi_hash_ctx_t *new_hmac_ctx(dpi_hash_kind_t kind,
+                                    const svOpenArrayHandle key,
+                                    uint64_t key_len,
+                                    void (*init)(dpi_hash_ctx_t *ctx,
+                                                 const void *key,
+                                                 unsigned int len)) {
+  dpi_hash_ctx_t *ctx = new_hash_ctx(kind);
+  if (key_len > 0u) {
+    uint8_t *key_arr = collect_bytes(key, key_len);
+    assert(key_arr);
+    init(ctx, key_arr, key_len);
+    free(key_arr);
+  } else {
+    init(ctx, NULL, 0u);
+  }
+  return ctx;
+}
+
+static void init_hmac_sha256(dpi_hash_ctx_t *ctx, const void *key,
+                             unsigned int len) {
+  HMAC_SHA256_init(&ctx->u.lite_hmac, key, len);
+}
+
+static void init_hmac_sha384(dpi_hash_ctx_t *ctx, const void *key,
+                             unsigned int len) {
+  HMAC_SHA384_init(&ctx->u.hmac, key, len);
+}
+
+static void init_hmac_sha512(dpi_hash_ctx_t *ctx, const void *key,
+                             unsigned int len) {
+  HMAC_SHA512_init(&ctx->u.hmac, key, len);
+}
+
+extern void *c_dpi_SHA256_init(void) {
+  dpi_hash_ctx_t *ctx = new_hash_ctx(kDpiHash);
+  SHA256_init(&ctx->u.hash);
+  return ctx;
+}
+
+extern void *c_dpi_SHA384_init(void) {
+  dpi_hash_ctx_t *ctx = new_hash_ctx(kDpiHash);
+  SHA384_init(&ctx->u.hash);
+  return ctx;
+}
+
+extern void *c_dpi_SHA512_init(void) {
+  dpi_hash_ctx_t *ctx = new_hash_ctx(kDpiHash);
+  SHA512_init(&ctx->u.hash);
+  return ctx;
+}
+
+extern void *c_dpi_HMAC_SHA256_init(const svOpenArrayHandle key,
+                                    uint64_t key_len) {
+  return new_hmac_ctx(kDpiHmacLite, key, key_len, init_hmac_sha256);
+}
+
+extern void *c_dpi_HMAC_SHA384_init(const svOpenArrayHandle key,
+                                    uint64_t key_len) {
+  return new_hmac_ctx(kDpiHmac, key, key_len, init_hmac_sha384);
+}
+
+extern void *c_dpi_HMAC_SHA512_init(const svOpenArrayHandle key,
+                                    uint64_t key_len) {
+  return new_hmac_ctx(kDpiHmac, key, key_len, init_hmac_sha512);
+}
+
+extern void c_dpi_hash_update(void *handle, const svOpenArrayHandle msg,
+                              uint64_t len) {
+  dpi_hash_ctx_t *ctx = (dpi_hash_ctx_t *)handle;
+  assert(ctx);
+  update_from_array(&ctx->u.hash, msg, len);
+}
+
+// Write the digest to the first words of digest (8 for SHA256, 12 for SHA384
+// and 16 for SHA512), with the remaining words set to zero, and free the
+// context.
+extern void c_dpi_hash_final(void *handle, uint32_t digest[16]) {
+  dpi_hash_ctx_t *ctx = (dpi_hash_ctx_t *)handle;
+  assert(ctx);
+
+  unsigned int size = HASH_size(&ctx->u.hash);
+  assert(size <= 16 * sizeof(uint32_t));
+
+  const uint8_t *result;
+  switch (ctx->kind) {
+    case kDpiHmacLite:
+      result = HMAC_final_LITE(&ctx->u.lite_hmac);
+      break;
+    case kDpiHmac:
+      result = HMAC_final(&ctx->u.hmac);
+      break;
+    default:
+      result = HASH_final(&ctx->u.hash);
+      break;
+  }
+
+  memset(digest, 0, 16 * sizeof(uint32_t));
+  memcpy(digest, result, size);
+  free(ctx);
+}
+
 extern void c_dpi_SHA_hash(const svOpenArrayHandle msg, uint64_t len,
                            uint32_t hash[8]) {
   if (len > 0u) {
-    uint8_t *arr = collect_bytes(msg, len);
-    assert(arr);
+    SHA_CTX ctx;
+    SHA_init(&ctx);
+    update_from_array(&ctx, msg, len);
 
     // compute SHA hash
-    SHA_hash(arr, len, (uint8_t *)hash);
-
-    free(arr);
+    memcpy(hash, SHA_final(&ctx), SHA_DIGEST_SIZE);
   }
 }
 
 extern void c_dpi_SHA256_hash(const svOpenArrayHandle msg, uint64_t len,
                               uint32_t hash[8]) {
-  if (len > 0u) {
-    uint8_t *arr = collect_bytes(msg, len);
-    assert(arr);
-
-    // compute SHA256 hash
-    SHA256_hash(arr, len, (uint8_t *)hash);
+  LITE_SHA256_CTX ctx;
+  SHA256_init(&ctx);
+  update_from_array(&ctx, msg, len);
 
-    free(arr);
-  } else {
-    // compute SHA256 hash when msg is empty
-    SHA256_hash(NULL, 0u, (uint8_t *)hash);
-  }
+  // compute SHA256 hash (of an empty message if len is zero)
+  memcpy(hash, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
 }
 
 extern void c_dpi_SHA384_hash(const svOpenArrayHandle msg, uint64_t len,
                               uint32_t hash[12]) {
-  if (len > 0u) {
-    uint8_t *arr = collect_bytes(msg, len);
-    assert(arr);
+  LITE_SHA384_CTX ctx;
+  SHA384_init(&ctx);
+  update_from_array(&ctx, msg, len);
 
-    // compute SHA384 hash
-    SHA384_hash(arr, len, (uint8_t *)hash);
-
-    free(arr);
-  } else {
-    // compute SHA384 hash when msg is empty
-    SHA384_hash(NULL, 0u, (uint8_t *)hash);
-  }
+  // compute SHA384 hash (of an empty message if len is zero)
+  memcpy(hash, SHA384_final(&ctx), SHA384_DIGEST_SIZE);
 }
 
 extern void c_dpi_SHA512_hash(const svOpenArrayHandle msg, uint64_t len,
                               uint32_t hash[16]) {
-  if (len > 0u) {
-    uint8_t *arr = collect_bytes(msg, len);
-    assert(arr);
-
-    // compute SHA512 hash
-    SHA512_hash(arr, len, (uint8_t *)hash);
+  LITE_SHA512_CTX ctx;
+  SHA512_init(&ctx);
+  update_from_array(&ctx, msg, len);
 
-    free(arr);
-  } else {
-    // compute SHA512 hash when msg is empty
-    SHA512_hash(NULL, 0u, (uint8_t *)hash);
-  }
+  // compute SHA512 hash (of an empty message if len is zero)
+  memcpy(hash, SHA512_final(&ctx), SHA512_DIGEST_SIZE);
 }
 
 extern void c_dpi_HMAC_SHA(const svOpenArrayHandle key, uint64_t key_len,
                            const svOpenArrayHandle msg, uint64_t msg_len,
                            uint32_t hmac[8]) {
   if (msg_len > 0u) {
-    uint8_t *msg_arr = collect_bytes(msg, msg_len);
-    assert(msg_arr);
-
     uint8_t *key_arr = collect_bytes(key, key_len);
     assert(key_arr);
 
-    // compute SHA hash
-    HMAC_SHA(key_arr, key_len, msg_arr, msg_len, (uint8_t *)hmac);
-
-    free(msg_arr);
+    LITE_HMAC_CTX ctx;
+    HMAC_SHA_init(&ctx, key_arr, key_len);
     free(key_arr);
+
+    // compute HMAC
+    update_from_array(&ctx.hash, msg, msg_len);
+    memcpy(hmac, HMAC_final_LITE(&ctx), SHA_DIGEST_SIZE);
   }
 }
 
 extern void c_dpi_HMAC_SHA256(const svOpenArrayHandle key, uint64_t key_len,
                               const svOpenArrayHandle msg, uint64_t msg_len,
                               uint32_t hmac[8]) {
-  uint8_t *key_arr = collect_bytes(key, key_len);
-  assert(key_arr);
-
-  if (msg_len > 0u) {
-    uint8_t *msg_arr = collect_bytes(msg, msg_len);
-    assert(msg_arr);
+  void *ctx = c_dpi_HMAC_SHA256_init(key, key_len);
+  c_dpi_hash_update(ctx, msg, msg_len);
 
-    // compute SHA256 hash
-    HMAC_SHA256(key_arr, key_len, msg_arr, msg_len, (uint8_t *)hmac);
-
-    free(msg_arr);
-  } else {
-    // compute SHA256 hash when msg is empty
-    HMAC_SHA256(key_arr, key_len, NULL, 0u, (uint8_t *)hmac);
-  }
-
-  free(key_arr);
+  uint32_t digest[16];
+  c_dpi_hash_final(ctx, digest);
+  memcpy(hmac, digest, SHA256_DIGEST_SIZE);
 }
+
 extern void c_dpi_HMAC_SHA384(const svOpenArrayHandle key, uint64_t key_len,
                               const svOpenArrayHandle msg, uint64_t msg_len,
                               uint32_t hmac[12]) {
-  uint8_t *key_arr = collect_bytes(key, key_len);
-  assert(key_arr);
-
-  if (msg_len > 0u) {
-    uint8_t *msg_arr = collect_bytes(msg, msg_len);
-    assert(msg_arr);
-
-    // compute SHA384 hash
-    HMAC_SHA384(key_arr, key_len, msg_arr, msg_len, (uint8_t *)hmac);
+  void *ctx = c_dpi_HMAC_SHA384_init(key, key_len);
+  c_dpi_hash_update(ctx, msg, msg_len);
 
-    free(msg_arr);
-  } else {
-    // compute SHA384 hash when msg is empty
-    HMAC_SHA384(key_arr, key_len, NULL, 0u, (uint8_t *)hmac);
-  }
-
-  free(key_arr);
+  uint32_t digest[16];
+  c_dpi_hash_final(ctx, digest);
+  memcpy(hmac, digest, SHA384_DIGEST_SIZE);
 }
 
 extern void c_dpi_HMAC_SHA512(const svOpenArrayHandle key, uint64_t key_len,
                               const svOpenArrayHandle msg, uint64_t msg_len,
                               uint32_t hmac[16]) {
-  uint8_t *key_arr = collect_bytes(key, key_len);
-  assert(key_arr);
-
-  if (msg_len > 0u) {
-    uint8_t *msg_arr = collect_bytes(msg, msg_len);
-    assert(msg_arr);
-
-    // compute SHA512 hash
-    HMAC_SHA512(key_arr, key_len, msg_arr, msg_len, (uint8_t *)hmac);
-
-    free(msg_arr);
-  } else {
-    // compute SHA512 hash when msg is empty
-    HMAC_SHA512(key_arr, key_len, NULL, 0u, (uint8_t *)hmac);
-  }
-
-  free(key_arr);
+  void *ctx = c_dpi_HMAC_SHA512_init(key, key_len);
+  c_dpi_hash_update(ctx, msg, msg_len);
+  c_dpi_hash_final(ctx, hmac);
 }
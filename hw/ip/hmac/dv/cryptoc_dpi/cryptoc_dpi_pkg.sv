@@ -54,6 +54,35 @@ package cryptoc_dpi_pkg;
                                                          input longint unsigned msg_len,
                                                          output int unsigned hmac[16]);
 
+  // Incremental hashing
+  //
+  // The c_dpi_*_init() functions start a new hash or HMAC computation and return a handle to its
+  // state. Message bytes are added with any number of calls to c_dpi_hash_update(), so a long
+  // message can be checked as it is consumed without ever being held as a whole.
+  // c_dpi_hash_final() writes the digest to the first 8 (SHA256), 12 (SHA384) or 16 (SHA512)
+  // words of digest, sets the other words to zero and frees the handle.
+  import "DPI-C" context function chandle c_dpi_SHA256_init();
+
+  import "DPI-C" context function chandle c_dpi_SHA384_init();
+
+  import "DPI-C" context function chandle c_dpi_SHA512_init();
+
+  import "DPI-C" context function chandle c_dpi_HMAC_SHA256_init(input bit[7:0] key[],
+                                                                 input longint unsigned key_len);
+
+  import "DPI-C" context function chandle c_dpi_HMAC_SHA384_init(input bit[7:0] key[],
+                                                                 input longint unsigned key_len);
+
+  import "DPI-C" context function chandle c_dpi_HMAC_SHA512_init(input bit[7:0] key[],
+                                                                 input longint unsigned key_len);
+
+  import "DPI-C" context function void c_dpi_hash_update(input chandle ctx,
+                                                         input bit[7:0] msg[],
+                                                         input longint unsigned len);
+
+  import "DPI-C" context function void c_dpi_hash_final(input chandle ctx,
+                                                        output int unsigned digest[16]);
+
   // sv wrapper functions
   function automatic void sv_dpi_get_sha_digest(input bit[7:0] msg[],
                                                 output int unsigned hash[8]);
@@ -115,4 +144,33 @@ package cryptoc_dpi_pkg;
     c_dpi_HMAC_SHA512(ckey, ckey.size(), msg, msg.size(), hmac);
   endfunction
 
+  function automatic chandle sv_dpi_hmac_sha256_init(input bit[31:0] key[]);
+    bit [7:0] ckey[];
+    int ckey_size_bytes = $bits(key) / 8;
+    ckey = new[ckey_size_bytes];
+    {>>{ckey}} = key;
+    return c_dpi_HMAC_SHA256_init(ckey, ckey.size());
+  endfunction
+
+  function automatic chandle sv_dpi_hmac_sha384_init(input bit[31:0] key[]);
+    bit [7:0] ckey[];
+    int ckey_size_bytes = $bits(key) / 8;
+    ckey = new[ckey_size_bytes];
+    {>>{ckey}} = key;
+    return c_dpi_HMAC_SHA384_init(ckey, ckey.size());
+  endfunction
+
+  function automatic chandle sv_dpi_hmac_sha512_init(input bit[31:0] key[]);
+    bit [7:0] ckey[];
+    int ckey_size_bytes = $bits(key) / 8;
+    ckey = new[ckey_size_bytes];
+    {>>{ckey}} = key;
+    return c_dpi_HMAC_SHA512_init(ckey, ckey.size());
+  endfunction
+
+  function automatic void sv_dpi_hash_update(input chandle ctx,
+                                             input bit[7:0] msg[]);
+    c_dpi_hash_update(ctx, msg, msg.size());
+  endfunction
+
 endpackage
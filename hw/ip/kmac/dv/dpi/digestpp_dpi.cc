@@ -2,48 +2,297 @@
 // Licensed under the Apache License, Version 2.0, see LICENSE for details.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
-#include <cstdio>
-#include <cstdlib>
 #include <cstring>
-#include <list>
+#include <vector>
 
 #include "svdpi.h"
 #include "vendor/kerukuro_digestpp/algorithm/kmac.hpp"
 #include "vendor/kerukuro_digestpp/algorithm/sha3.hpp"
 #include "vendor/kerukuro_digestpp/algorithm/shake.hpp"
 
-extern "C" {
-
 //////////////////////
 // HELPER FUNCTIONS //
 //////////////////////
 
 /**
- * Generic function to load an unsized array from SV memory into C memory.
+ * Size of the buffer used to move bytes between SV and C memory when the
+ * simulator doesn't give direct access to an array.
+ */
+static const size_t kChunkLen = 4096;
+
+/**
+ * Get direct access to the elements of an unsized `bit[7:0]` array.
+ *
+ * Returns a pointer to the first element, or nullptr if the simulator doesn't
+ * store the array contiguously (or the array is empty). On success, `stride`
+ * is set to the distance in bytes between elements: 1 if the simulator stores
+ * one byte per element, or the size of an svBitVecVal for the canonical
+ * representation, in which each byte is the low byte of a little-endian word.
+ */
+static uint8_t *get_arr_ptr(const svOpenArrayHandle arr, uint64_t len,
+                            size_t *stride) {
+  *stride = 1;
+  if (len == 0) {
+    return nullptr;
+  }
+  uint8_t *ptr = (uint8_t *)svGetArrayPtr(arr);
+  if (ptr == nullptr) {
+    return nullptr;
+  }
+  *stride = svSizeOfArray(arr) / svSize(arr, 1);
+  return ptr;
+}
+
+/**
+ * Copy `len` elements of an unsized array, starting at element `offset`, from
+ * SV memory into C memory.
+ *
+ * `ptr` and `stride` are as returned by get_arr_ptr(); if `ptr` is null, the
+ * elements are read one at a time through the DPI accessors instead.
  */
 static void load_arr_from_simulator(const svOpenArrayHandle arr,
-                                    uint8_t *array_out, uint64_t array_len) {
-  for (uint64_t i = 0; i < array_len; i++) {
+                                    const uint8_t *ptr, size_t stride,
+                                    uint64_t offset, uint8_t *array_out,
+                                    uint64_t len) {
+  if (ptr != nullptr) {
+    if (stride == 1) {
+      memcpy(array_out, ptr + offset, len);
+      return;
+    }
+    for (uint64_t i = 0; i < len; i++) {
+      array_out[i] = ptr[(offset + i) * stride];
+    }
+    return;
+  }
+  for (uint64_t i = 0; i < len; i++) {
     svBitVecVal val;
-    svGetBitArrElem1VecVal(&val, arr, i);
+    svGetBitArrElem1VecVal(&val, arr, offset + i);
     array_out[i] = (uint8_t)val;
   }
 }
 
 /**
- * Generic function to write an unsized array from C memory into SV memory.
+ * Copy `len` bytes from C memory into an unsized array in SV memory, starting
+ * at element `offset`.
+ *
+ * `ptr` and `stride` are as for load_arr_from_simulator().
  */
 static void write_array_to_simulator(const svOpenArrayHandle arr,
-                                     uint8_t *data) {
-  uint64_t arr_len = svSize(arr, 1);
-
-  for (uint64_t i = 0; i < arr_len; ++i) {
+                                     uint8_t *ptr, size_t stride,
+                                     uint64_t offset, const uint8_t *data,
+                                     uint64_t len) {
+  if (ptr != nullptr) {
+    if (stride == 1) {
+      memcpy(ptr + offset, data, len);
+      return;
+    }
+    for (uint64_t i = 0; i < len; i++) {
+      uint8_t *elem = ptr + (offset + i) * stride;
+      memset(elem, 0, stride);
+      elem[0] = data[i];
+    }
+    return;
+  }
+  for (uint64_t i = 0; i < len; ++i) {
     svBitVecVal data_val = (svBitVecVal)data[i];
-    svPutBitArrElem1VecVal(arr, &data_val, i);
+    svPutBitArrElem1VecVal(arr, &data_val, offset + i);
+  }
+}
+
+/**
+ * Load a whole unsized array (such as a key) from SV memory.
+ */
+static std::vector<uint8_t> load_vector_from_simulator(
+    const svOpenArrayHandle arr, uint64_t len) {
+  std::vector<uint8_t> out(len);
+  size_t stride;
+  const uint8_t *ptr = get_arr_ptr(arr, len, &stride);
+  load_arr_from_simulator(arr, ptr, stride, 0, out.data(), len);
+  return out;
+}
+
+/**
+ * Write a computed digest back to SV memory.
+ *
+ * At most `len` bytes are written, and no more than the array can hold.
+ */
+static void write_digest_to_simulator(const svOpenArrayHandle arr,
+                                      const uint8_t *data, uint64_t len) {
+  len = std::min(len, (uint64_t)svSize(arr, 1));
+  size_t stride;
+  uint8_t *ptr = get_arr_ptr(arr, len, &stride);
+  write_array_to_simulator(arr, ptr, stride, 0, data, len);
+}
+
+/**
+ * Absorb the first `msg_len` bytes of a message held in SV memory.
+ *
+ * If the simulator stores the message as contiguous bytes, they are absorbed
+ * in place. Otherwise the message is streamed through a fixed-size buffer, so
+ * that long messages never need a full copy in C memory.
+ */
+template <typename H>
+static void absorb_from_simulator(H &hasher, const svOpenArrayHandle msg,
+                                  uint64_t msg_len) {
+  size_t stride;
+  const uint8_t *ptr = get_arr_ptr(msg, msg_len, &stride);
+  if (ptr != nullptr && stride == 1) {
+    hasher.absorb(ptr, msg_len);
+    return;
+  }
+
+  uint8_t chunk[kChunkLen];
+  for (uint64_t offset = 0; offset < msg_len;) {
+    uint64_t len = std::min(msg_len - offset, (uint64_t)kChunkLen);
+    load_arr_from_simulator(msg, ptr, stride, offset, chunk, len);
+    hasher.absorb(chunk, len);
+    offset += len;
+  }
+}
+
+/**
+ * Squeeze `output_len` bytes out of an extendable-output function straight
+ * into SV memory, in place or through a fixed-size buffer as for
+ * absorb_from_simulator().
+ */
+template <typename H>
+static void squeeze_to_simulator(H &xof, uint64_t output_len,
+                                 const svOpenArrayHandle digest) {
+  output_len = std::min(output_len, (uint64_t)svSize(digest, 1));
+  size_t stride;
+  uint8_t *ptr = get_arr_ptr(digest, output_len, &stride);
+  if (ptr != nullptr && stride == 1) {
+    xof.squeeze(ptr, output_len);
+    return;
   }
+
+  uint8_t chunk[kChunkLen];
+  for (uint64_t offset = 0; offset < output_len;) {
+    uint64_t len = std::min(output_len - offset, (uint64_t)kChunkLen);
+    xof.squeeze(chunk, len);
+    write_array_to_simulator(digest, ptr, stride, offset, chunk, len);
+    offset += len;
+  }
+}
+
+/**
+ * Compute a fixed-length digest of `output_len` bytes and write it to SV
+ * memory.
+ */
+template <typename H>
+static void digest_to_simulator(H &hasher, uint64_t output_len,
+                                const svOpenArrayHandle digest) {
+  std::vector<uint8_t> digest_arr(output_len);
+  hasher.digest(digest_arr.data(), digest_arr.size());
+  write_digest_to_simulator(digest, digest_arr.data(), digest_arr.size());
 }
 
+/**
+ * State of an incremental computation started from SV with one of the
+ * c_dpi_*_init() functions, passed to SV as a chandle.
+ */
+class DigestppState {
+ public:
+  DigestppState() : squeezed_(false) {}
+  virtual ~DigestppState() {}
+
+  /**
+   * Absorb the first `msg_len` bytes of `msg`.
+   *
+   * This is only allowed before the first call to Squeeze().
+   */
+  void Absorb(const svOpenArrayHandle msg, uint64_t msg_len) {
+    assert(!squeezed_ && "Absorbing after squeezing.");
+    AbsorbFromSimulator(msg, msg_len);
+  }
+
+  /**
+   * Write up to `output_len` bytes of output to `digest`.
+   */
+  void Squeeze(uint64_t output_len, svOpenArrayHandle digest) {
+    squeezed_ = true;
+    SqueezeToSimulator(output_len, digest);
+  }
+
+ protected:
+  virtual void AbsorbFromSimulator(const svOpenArrayHandle msg,
+                                   uint64_t msg_len) = 0;
+  virtual void SqueezeToSimulator(uint64_t output_len,
+                                  svOpenArrayHandle digest) = 0;
+
+ private:
+  bool squeezed_;
+};
+
+/**
+ * The state of an extendable-output function. Each call to Squeeze() returns
+ * the next `output_len` bytes of output.
+ */
+template <typename H>
+class DigestppXofState : public DigestppState {
+ public:
+  H hasher;
+
+ protected:
+  void AbsorbFromSimulator(const svOpenArrayHandle msg,
+                           uint64_t msg_len) override {
+    absorb_from_simulator(hasher, msg, msg_len);
+  }
+
+  void SqueezeToSimulator(uint64_t output_len,
+                          svOpenArrayHandle digest) override {
+    squeeze_to_simulator(hasher, output_len, digest);
+  }
+};
+
+/**
+ * The state of a fixed-length hash function. Squeeze() returns the first
+ * `output_len` bytes of the digest, every time it is called.
+ */
+template <typename H>
+class DigestppHashState : public DigestppState {
+ public:
+  explicit DigestppHashState(size_t hash_size)
+      : hasher(hash_size), digest_len_(hash_size / 8) {}
+
+  H hasher;
+
+ protected:
+  void AbsorbFromSimulator(const svOpenArrayHandle msg,
+                           uint64_t msg_len) override {
+    absorb_from_simulator(hasher, msg, msg_len);
+  }
+
+  void SqueezeToSimulator(uint64_t output_len,
+                          svOpenArrayHandle digest) override {
+    std::vector<uint8_t> digest_arr(digest_len_);
+    hasher.digest(digest_arr.data(), digest_arr.size());
+    write_digest_to_simulator(digest, digest_arr.data(),
+                              std::min(output_len, (uint64_t)digest_len_));
+  }
+
+ private:
+  size_t digest_len_;
+};
+
+/**
+ * Start a KMAC computation, with the key and customization string applied.
+ */
+template <typename S>
+static S *new_kmac_state(S *state, const svOpenArrayHandle key,
+                         uint64_t key_len, const char *customization_str) {
+  std::vector<uint8_t> key_arr = load_vector_from_simulator(key, key_len);
+  state->hasher.set_customization(customization_str,
+                                  strlen(customization_str));
+  state->hasher.set_key(key_arr.data(), key_len);
+  return state;
+}
+
+extern "C" {
+
 /**
  * Helper function to calculate generic length SHA3 algorithm.
  *
@@ -53,26 +302,9 @@ static void write_array_to_simulator(const svOpenArrayHandle arr,
  */
 static void get_sha3_digest(uint64_t sha_len, const svOpenArrayHandle msg,
                             uint64_t msg_len, svOpenArrayHandle digest) {
-  // Number of bytes in result digest
-  uint64_t digest_len = sha_len / 8;
-
-  uint8_t digest_arr[digest_len];
-
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  // Compute the digest
   digestpp::sha3 sha3(sha_len);
-  sha3.absorb(msg_arr, msg_len);
-  sha3.digest(digest_arr, sizeof(digest_arr));
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  // Return the digest array so that SV can access it
-  write_array_to_simulator(digest, digest_arr);
+  absorb_from_simulator(sha3, msg, msg_len);
+  digest_to_simulator(sha3, sha_len / 8, digest);
 }
 
 //////////////
@@ -112,23 +344,9 @@ extern void c_dpi_sha3_512(const svOpenArrayHandle msg, uint64_t msg_len,
 //////////////
 extern void c_dpi_shake128(const svOpenArrayHandle msg, uint64_t msg_len,
                            uint64_t output_len, svOpenArrayHandle digest) {
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
   digestpp::shake128 shake;
-  shake.absorb(msg_arr, msg_len);
-  shake.squeeze(digest_arr, output_len);
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  absorb_from_simulator(shake, msg, msg_len);
+  squeeze_to_simulator(shake, output_len, digest);
 }
 
 //////////////
@@ -136,23 +354,9 @@ extern void c_dpi_shake128(const svOpenArrayHandle msg, uint64_t msg_len,
 //////////////
 extern void c_dpi_shake256(const svOpenArrayHandle msg, uint64_t msg_len,
                            uint64_t output_len, svOpenArrayHandle digest) {
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
   digestpp::shake256 shake;
-  shake.absorb(msg_arr, msg_len);
-  shake.squeeze(digest_arr, output_len);
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  absorb_from_simulator(shake, msg, msg_len);
+  squeeze_to_simulator(shake, output_len, digest);
 }
 
 ///////////////
@@ -162,25 +366,11 @@ extern void c_dpi_cshake128(const svOpenArrayHandle msg,
                             const char *function_name,
                             const char *customization_str, uint64_t msg_len,
                             uint64_t output_len, svOpenArrayHandle digest) {
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
   digestpp::cshake128 shake;
   shake.set_function_name(function_name, strlen(function_name));
   shake.set_customization(customization_str, strlen(customization_str));
-  shake.absorb(msg_arr, msg_len);
-  shake.squeeze(digest_arr, output_len);
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  absorb_from_simulator(shake, msg, msg_len);
+  squeeze_to_simulator(shake, output_len, digest);
 }
 
 ///////////////
@@ -190,25 +380,11 @@ extern void c_dpi_cshake256(const svOpenArrayHandle msg,
                             const char *function_name,
                             const char *customization_str, uint64_t msg_len,
                             uint64_t output_len, svOpenArrayHandle digest) {
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
   digestpp::cshake256 shake;
   shake.set_function_name(function_name, strlen(function_name));
   shake.set_customization(customization_str, strlen(customization_str));
-  shake.absorb(msg_arr, msg_len);
-  shake.squeeze(digest_arr, output_len);
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  absorb_from_simulator(shake, msg, msg_len);
+  squeeze_to_simulator(shake, output_len, digest);
 }
 
 /////////////
@@ -217,36 +393,14 @@ extern void c_dpi_cshake256(const svOpenArrayHandle msg,
 extern void c_dpi_kmac128(const svOpenArrayHandle msg, uint64_t msg_len,
                           const svOpenArrayHandle key, uint64_t key_len,
                           const char *customization_str, uint64_t output_len,
-                          svBitVecVal *digest) {
-  uint64_t output_len_bits = output_len * 8;
+                          svOpenArrayHandle digest) {
+  std::vector<uint8_t> key_arr = load_vector_from_simulator(key, key_len);
 
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  // Load key from SV memory
-  uint8_t *key_arr = (uint8_t *)malloc(key_len * sizeof(uint8_t));
-  load_arr_from_simulator(key, key_arr, key_len);
-
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
-  digestpp::kmac128 kmac(output_len_bits);
+  digestpp::kmac128 kmac(output_len * 8);
   kmac.set_customization(customization_str, strlen(customization_str));
-  kmac.set_key(key_arr, key_len);
-  kmac.absorb(msg_arr, msg_len);
-  kmac.digest(digest_arr, sizeof(digest_arr));
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  if (key_arr != nullptr) {
-    free(key_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  kmac.set_key(key_arr.data(), key_len);
+  absorb_from_simulator(kmac, msg, msg_len);
+  digest_to_simulator(kmac, output_len, digest);
 }
 
 /////////////////
@@ -255,34 +409,14 @@ extern void c_dpi_kmac128(const svOpenArrayHandle msg, uint64_t msg_len,
 extern void c_dpi_kmac128_xof(const svOpenArrayHandle msg, uint64_t msg_len,
                               const svOpenArrayHandle key, uint64_t key_len,
                               const char *customization_str,
-                              uint64_t output_len, svBitVecVal *digest) {
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  // Load key from SV memory
-  uint8_t *key_arr = (uint8_t *)malloc(key_len * sizeof(uint8_t));
-  load_arr_from_simulator(key, key_arr, key_len);
+                              uint64_t output_len, svOpenArrayHandle digest) {
+  std::vector<uint8_t> key_arr = load_vector_from_simulator(key, key_len);
 
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
   digestpp::kmac128_xof kmac;
   kmac.set_customization(customization_str, strlen(customization_str));
-  kmac.set_key(key_arr, key_len);
-  kmac.absorb(msg_arr, msg_len);
-  kmac.squeeze(digest_arr, sizeof(digest_arr));
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  if (key_arr != nullptr) {
-    free(key_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  kmac.set_key(key_arr.data(), key_len);
+  absorb_from_simulator(kmac, msg, msg_len);
+  squeeze_to_simulator(kmac, output_len, digest);
 }
 
 /////////////
@@ -291,36 +425,14 @@ extern void c_dpi_kmac128_xof(const svOpenArrayHandle msg, uint64_t msg_len,
 extern void c_dpi_kmac256(const svOpenArrayHandle msg, uint64_t msg_len,
                           const svOpenArrayHandle key, uint64_t key_len,
                           const char *customization_str, uint64_t output_len,
-                          svBitVecVal *digest) {
-  uint64_t output_len_bits = output_len * 8;
-
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
-
-  // Load key from SV memory
-  uint8_t *key_arr = (uint8_t *)malloc(key_len * sizeof(uint8_t));
-  load_arr_from_simulator(key, key_arr, key_len);
-
-  uint8_t digest_arr[output_len];
+                          svOpenArrayHandle digest) {
+  std::vector<uint8_t> key_arr = load_vector_from_simulator(key, key_len);
 
-  // Compute the digest
-  digestpp::kmac256 kmac(output_len_bits);
+  digestpp::kmac256 kmac(output_len * 8);
   kmac.set_customization(customization_str, strlen(customization_str));
-  kmac.set_key(key_arr, key_len);
-  kmac.absorb(msg_arr, msg_len);
-  kmac.digest(digest_arr, sizeof(digest_arr));
-
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
-
-  if (key_arr != nullptr) {
-    free(key_arr);
-  }
-
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+  kmac.set_key(key_arr.data(), key_len);
+  absorb_from_simulator(kmac, msg, msg_len);
+  digest_to_simulator(kmac, output_len, digest);
 }
 
 /////////////////
@@ -329,33 +441,104 @@ extern void c_dpi_kmac256(const svOpenArrayHandle msg, uint64_t msg_len,
 extern void c_dpi_kmac256_xof(const svOpenArrayHandle msg, uint64_t msg_len,
                               const svOpenArrayHandle key, uint64_t key_len,
                               const char *customization_str,
-                              uint64_t output_len, svBitVecVal *digest) {
-  // Load message from SV memory
-  uint8_t *msg_arr = (uint8_t *)malloc(msg_len * sizeof(uint8_t));
-  load_arr_from_simulator(msg, msg_arr, msg_len);
+                              uint64_t output_len, svOpenArrayHandle digest) {
+  std::vector<uint8_t> key_arr = load_vector_from_simulator(key, key_len);
 
-  // Load key from SV memory
-  uint8_t *key_arr = (uint8_t *)malloc(key_len * sizeof(uint8_t));
-  load_arr_from_simulator(key, key_arr, key_len);
-
-  uint8_t digest_arr[output_len];
-
-  // Compute the digest
   digestpp::kmac256_xof kmac;
   kmac.set_customization(customization_str, strlen(customization_str));
-  kmac.set_key(key_arr, key_len);
-  kmac.absorb(msg_arr, msg_len);
-  kmac.squeeze(digest_arr, sizeof(digest_arr));
+  kmac.set_key(key_arr.data(), key_len);
+  absorb_from_simulator(kmac, msg, msg_len);
+  squeeze_to_simulator(kmac, output_len, digest);
+}
 
-  if (msg_arr != nullptr) {
-    free(msg_arr);
-  }
+/////////////////////////////
+// Incremental computation //
+/////////////////////////////
 
-  if (key_arr != nullptr) {
-    free(key_arr);
-  }
+// The c_dpi_*_init() functions start a new computation and return a handle to
+// its state. Message bytes are added with any number of calls to
+// c_dpi_digestpp_absorb(), so a long message can be checked as the design
+// consumes it. c_dpi_digestpp_squeeze() then writes the output and
+// c_dpi_digestpp_free() frees the state.
+
+extern void *c_dpi_sha3_init(uint64_t sha_len) {
+  return new DigestppHashState<digestpp::sha3>(sha_len);
+}
+
+extern void *c_dpi_shake128_init(void) {
+  return new DigestppXofState<digestpp::shake128>();
+}
+
+extern void *c_dpi_shake256_init(void) {
+  return new DigestppXofState<digestpp::shake256>();
+}
+
+extern void *c_dpi_cshake128_init(const char *function_name,
+                                  const char *customization_str) {
+  auto state = new DigestppXofState<digestpp::cshake128>();
+  state->hasher.set_function_name(function_name, strlen(function_name));
+  state->hasher.set_customization(customization_str,
+                                  strlen(customization_str));
+  return state;
+}
+
+extern void *c_dpi_cshake256_init(const char *function_name,
+                                  const char *customization_str) {
+  auto state = new DigestppXofState<digestpp::cshake256>();
+  state->hasher.set_function_name(function_name, strlen(function_name));
+  state->hasher.set_customization(customization_str,
+                                  strlen(customization_str));
+  return state;
+}
+
+// The output length of KMAC is part of its input, so it is fixed here.
+extern void *c_dpi_kmac128_init(const svOpenArrayHandle key, uint64_t key_len,
+                                const char *customization_str,
+                                uint64_t output_len) {
+  return new_kmac_state(
+      new DigestppHashState<digestpp::kmac128>(output_len * 8), key, key_len,
+      customization_str);
+}
+
+extern void *c_dpi_kmac128_xof_init(const svOpenArrayHandle key,
+                                    uint64_t key_len,
+                                    const char *customization_str) {
+  return new_kmac_state(new DigestppXofState<digestpp::kmac128_xof>(), key,
+                        key_len, customization_str);
+}
+
+extern void *c_dpi_kmac256_init(const svOpenArrayHandle key, uint64_t key_len,
+                                const char *customization_str,
+                                uint64_t output_len) {
+  return new_kmac_state(
+      new DigestppHashState<digestpp::kmac256>(output_len * 8), key, key_len,
+      customization_str);
+}
+
+extern void *c_dpi_kmac256_xof_init(const svOpenArrayHandle key,
+                                    uint64_t key_len,
+                                    const char *customization_str) {
+  return new_kmac_state(new DigestppXofState<digestpp::kmac256_xof>(), key,
+                        key_len, customization_str);
+}
+
+extern void c_dpi_digestpp_absorb(void *handle, const svOpenArrayHandle msg,
+                                  uint64_t msg_len) {
+  DigestppState *state = (DigestppState *)handle;
+  assert(state);
+  state->Absorb(msg, msg_len);
+}
+
+// For the SHA3 and KMAC functions, write the first `output_len` bytes of the
+// digest. For the XOFs, write the next `output_len` bytes of output.
+extern void c_dpi_digestpp_squeeze(void *handle, uint64_t output_len,
+                                   svOpenArrayHandle digest) {
+  DigestppState *state = (DigestppState *)handle;
+  assert(state);
+  state->Squeeze(output_len, digest);
+}
 
-  // Return the digest array to SV code
-  write_array_to_simulator(digest, digest_arr);
+extern void c_dpi_digestpp_free(void *handle) {
+  delete (DigestppState *)handle;
 }
 }
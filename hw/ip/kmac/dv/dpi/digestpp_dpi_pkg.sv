@@ -107,4 +107,72 @@ package digestpp_dpi_pkg;
     output bit[7:0]         digest[]
   );
 
+  // Incremental computation
+  //
+  // The c_dpi_*_init() functions start a new computation and return a handle to its state.
+  // Message bytes are added with any number of calls to c_dpi_digestpp_absorb(), so a long
+  // message can be checked as it is consumed without ever being held as a whole.
+  // c_dpi_digestpp_squeeze() writes the first output_len bytes of the digest for SHA3 and KMAC,
+  // or the next output_len bytes of output for the XOFs, after which no more bytes may be
+  // absorbed. c_dpi_digestpp_free() frees the handle.
+  import "DPI-C" context function chandle c_dpi_sha3_init(
+    input longint unsigned  sha_len
+  );
+
+  import "DPI-C" context function chandle c_dpi_shake128_init();
+
+  import "DPI-C" context function chandle c_dpi_shake256_init();
+
+  import "DPI-C" context function chandle c_dpi_cshake128_init(
+    input string            function_name,
+    input string            customization_str
+  );
+
+  import "DPI-C" context function chandle c_dpi_cshake256_init(
+    input string            function_name,
+    input string            customization_str
+  );
+
+  import "DPI-C" context function chandle c_dpi_kmac128_init(
+    input bit[7:0]          key[],
+    input longint unsigned  key_len,
+    input string            customization_str,
+    input longint unsigned  output_len
+  );
+
+  import "DPI-C" context function chandle c_dpi_kmac128_xof_init(
+    input bit[7:0]          key[],
+    input longint unsigned  key_len,
+    input string            customization_str
+  );
+
+  import "DPI-C" context function chandle c_dpi_kmac256_init(
+    input bit[7:0]          key[],
+    input longint unsigned  key_len,
+    input string            customization_str,
+    input longint unsigned  output_len
+  );
+
+  import "DPI-C" context function chandle c_dpi_kmac256_xof_init(
+    input bit[7:0]          key[],
+    input longint unsigned  key_len,
+    input string            customization_str
+  );
+
+  import "DPI-C" context function void c_dpi_digestpp_absorb(
+    input chandle           ctx,
+    input bit[7:0]          msg[],
+    input longint unsigned  msg_len
+  );
+
+  import "DPI-C" context function void c_dpi_digestpp_squeeze(
+    input chandle           ctx,
+    input longint unsigned  output_len,
+    output bit[7:0]         digest[]
+  );
+
+  import "DPI-C" context function void c_dpi_digestpp_free(
+    input chandle           ctx
+  );
+
 endpackage
@@ -6,295 +6,419 @@
 
 #include <algorithm>
 #include <cassert>
-#include <functional>
-#include <iostream>
 #include <stdint.h>
 #include <vector>
 
-#include "prince_ref.h"
-
-uint8_t PRESENT_SBOX4[] = {0xc, 0x5, 0x6, 0xb, 0x9, 0x0, 0xa, 0xd,
-                           0x3, 0xe, 0xf, 0x8, 0x4, 0x7, 0x1, 0x2};
-
-uint8_t PRESENT_SBOX4_INV[] = {0x5, 0xe, 0xf, 0x8, 0xc, 0x1, 0x2, 0xd,
-                               0xb, 0x4, 0x6, 0x3, 0x0, 0x7, 0x9, 0xa};
+// The model works on 64-bit words rather than on byte vectors: each layer of
+// the substitution/permutation network and of PRINCE transforms a whole
+// word, using lookup tables for the S-boxes and the PRINCE M' matrices and
+// shifts and masks for the bit permutations. Byte vectors are only used at
+// the interface, so scrambling a word doesn't allocate anything apart from
+// the returned vector.
+
+static const uint8_t PRESENT_SBOX4[] = {0xc, 0x5, 0x6, 0xb, 0x9, 0x0,
+                                        0xa, 0xd, 0x3, 0xe, 0xf, 0x8,
+                                        0x4, 0x7, 0x1, 0x2};
+
+static const uint8_t PRESENT_SBOX4_INV[] = {0x5, 0xe, 0xf, 0x8, 0xc, 0x1,
+                                            0x2, 0xd, 0xb, 0x4, 0x6, 0x3,
+                                            0x0, 0x7, 0x9, 0xa};
+
+static const uint8_t PRINCE_SBOX4[] = {0xb, 0xf, 0x3, 0x2, 0xa, 0xc,
+                                       0x9, 0x1, 0x6, 0x7, 0x8, 0x0,
+                                       0xe, 0x5, 0xd, 0x4};
+
+static const uint8_t PRINCE_SBOX4_INV[] = {0xb, 0x7, 0x3, 0x2, 0xf, 0xd,
+                                           0x8, 0x9, 0xa, 0x6, 0x4, 0x0,
+                                           0x5, 0xe, 0xc, 0x1};
+
+// The 16-bit matrices M0 and M1 of the PRINCE M' layer, as the image of each
+// input bit
+static const uint16_t PRINCE_M16[2][16] = {
+    {0x0111, 0x2220, 0x4404, 0x8088, 0x1011, 0x0222, 0x4440, 0x8808, 0x1101,
+     0x2022, 0x0444, 0x8880, 0x1110, 0x2202, 0x4044, 0x0888},
+    {0x1110, 0x2202, 0x4044, 0x0888, 0x0111, 0x2220, 0x4404, 0x8088, 0x1011,
+     0x0222, 0x4440, 0x8808, 0x1101, 0x2022, 0x0444, 0x8880}};
+
+static const uint64_t PRINCE_RC[] = {
+    0x0000000000000000, 0x13198a2e03707344, 0xa4093822299f31d0,
+    0x082efa98ec4e6c89, 0x452821e638d01377, 0xbe5466cf34e90c6c,
+    0x7ef84f78fd955cb1, 0x85840851f1ac43aa, 0xc882d32f25323c54,
+    0x64a51195e0e3610d, 0xd3b5a399ca0c2399, 0xc0ac29b7c97c50dd};
 
 static const uint32_t kNumAddrSubstPermRounds = 2;
 static const uint32_t kNumDataSubstPermRounds = 2;
 static const uint32_t kNumPrinceHalfRounds = 3;
 
-static std::vector<uint8_t> byte_reverse_vector(
-    const std::vector<uint8_t> &vec_in) {
-  std::vector<uint8_t> vec_out(vec_in.size());
-
-  std::reverse_copy(std::begin(vec_in), std::end(vec_in), std::begin(vec_out));
+namespace {
+// Lookup tables derived from the constants above
+struct ScrambleTables {
+  // 4-bit S-boxes applied to both nibbles of a byte
+  uint8_t present_sbox8[256];
+  uint8_t present_sbox8_inv[256];
+  uint8_t prince_sbox8[256];
+  uint8_t prince_sbox8_inv[256];
+  // prince_m16[m][half][byte] is M<m> applied to byte, placed in the lower
+  // (half = 0) or upper (half = 1) byte of a 16-bit chunk
+  uint16_t prince_m16[2][2][256];
+
+  ScrambleTables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      present_sbox8[i] = PRESENT_SBOX4[i & 0xf] | PRESENT_SBOX4[i >> 4] << 4;
+      present_sbox8_inv[i] =
+          PRESENT_SBOX4_INV[i & 0xf] | PRESENT_SBOX4_INV[i >> 4] << 4;
+      prince_sbox8[i] = PRINCE_SBOX4[i & 0xf] | PRINCE_SBOX4[i >> 4] << 4;
+      prince_sbox8_inv[i] =
+          PRINCE_SBOX4_INV[i & 0xf] | PRINCE_SBOX4_INV[i >> 4] << 4;
+
+      for (uint32_t m = 0; m < 2; ++m) {
+        for (uint32_t half = 0; half < 2; ++half) {
+          uint16_t out = 0;
+          for (uint32_t bit = 0; bit < 8; ++bit) {
+            if ((i >> bit) & 1) {
+              out ^= PRINCE_M16[m][8 * half + bit];
+            }
+          }
+          prince_m16[m][half][i] = out;
+        }
+      }
+    }
+  }
+};
+}  // namespace
 
-  return vec_out;
+static const ScrambleTables &GetTables() {
+  static const ScrambleTables tables;
+  return tables;
 }
 
-static uint8_t read_vector_bit(const std::vector<uint8_t> &vec,
-                               uint32_t bit_pos) {
-  assert(bit_pos / 8 < vec.size());
-
-  return (vec[bit_pos / 8] >> (bit_pos % 8)) & 1;
+// A mask of the bottom width bits of a word
+static uint64_t width_mask(uint32_t width) {
+  assert(width <= 64);
+  return width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
 }
 
-static void or_vector_bit(std::vector<uint8_t> &vec, uint32_t bit_pos,
-                          uint8_t bit) {
-  assert(bit_pos / 8 < vec.size());
-
-  vec[bit_pos / 8] |= bit << (bit_pos % 8);
+static uint64_t rotl64(uint64_t x, uint32_t shift) {
+  shift %= 64;
+  return shift ? (x << shift) | (x >> (64 - shift)) : x;
 }
 
-static std::vector<uint8_t> xor_vectors(const std::vector<uint8_t> &vec_a,
-                                        const std::vector<uint8_t> &vec_b) {
-  assert(vec_a.size() == vec_b.size());
-
-  std::vector<uint8_t> vec_out(vec_a.size());
-
-  std::transform(vec_a.begin(), vec_a.end(), vec_b.begin(), vec_out.begin(),
-                 std::bit_xor<uint8_t>{});
-
-  return vec_out;
+// Apply an 8-bit lookup table to each byte of a word
+static uint64_t lookup_bytes(uint64_t in, const uint8_t table[256]) {
+  uint64_t out = 0;
+  for (uint32_t i = 0; i < 64; i += 8) {
+    out |= (uint64_t)table[(in >> i) & 0xff] << i;
+  }
+  return out;
 }
 
-// Run each 4-bit chunk of bytes from `in` through the SBOX. Where `bit_width`
-// isn't a multiple of 4 the remaining bits are just copied straight through.
-// `invert` choose whether to use the inverted SBOX or not.
-static std::vector<uint8_t> scramble_sbox_layer(const std::vector<uint8_t> &in,
-                                                uint32_t bit_width,
-                                                uint8_t sbox[16]) {
-  assert(in.size() == ((bit_width + 7) / 8));
-  std::vector<uint8_t> out(in.size(), 0);
-
-  // Iterate through each 4 bit chunk of the data and apply the appropriate SBOX
-  for (uint32_t i = 0; i < bit_width / 4; ++i) {
-    uint8_t sbox_in, sbox_out;
-
-    sbox_in = in[i / 2];
-
-    int shift = (i % 2) ? 4 : 0;
-    sbox_in = (sbox_in >> shift) & 0xf;
+// Gather the even bits of x into the bottom 32 bits
+static uint64_t compress_even_bits(uint64_t x) {
+  x &= 0x5555555555555555;
+  x = (x | (x >> 1)) & 0x3333333333333333;
+  x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0f;
+  x = (x | (x >> 4)) & 0x00ff00ff00ff00ff;
+  x = (x | (x >> 8)) & 0x0000ffff0000ffff;
+  x = (x | (x >> 16)) & 0x00000000ffffffff;
+  return x;
+}
 
-    sbox_out = sbox[sbox_in];
+// Spread the bottom 32 bits of x to the even bits, the inverse of
+// compress_even_bits
+static uint64_t spread_even_bits(uint64_t x) {
+  x &= 0x00000000ffffffff;
+  x = (x | (x << 16)) & 0x0000ffff0000ffff;
+  x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+  x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+  x = (x | (x << 2)) & 0x3333333333333333;
+  x = (x | (x << 1)) & 0x5555555555555555;
+  return x;
+}
 
-    out[i / 2] |= sbox_out << shift;
-  }
+static uint64_t reverse_bits64(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555) | ((x & 0x5555555555555555) << 1);
+  x = ((x >> 2) & 0x3333333333333333) | ((x & 0x3333333333333333) << 2);
+  x = ((x >> 4) & 0x0f0f0f0f0f0f0f0f) | ((x & 0x0f0f0f0f0f0f0f0f) << 4);
+  x = ((x >> 8) & 0x00ff00ff00ff00ff) | ((x & 0x00ff00ff00ff00ff) << 8);
+  x = ((x >> 16) & 0x0000ffff0000ffff) | ((x & 0x0000ffff0000ffff) << 16);
+  return (x >> 32) | (x << 32);
+}
 
-  // Where bit_width is not a multiple of 4 copy over the remaining bits
-  if (bit_width % 4) {
-    int shift = ((bit_width % 8) >= 4) ? 4 : 0;
-    uint8_t nibble = (in[bit_width / 8] >> shift) & 0xf;
-    out[bit_width / 8] |= nibble << shift;
+// Read width <= 64 bits, starting at bit bit_pos, from little-endian bytes
+static uint64_t read_bits(const uint8_t *bytes, uint32_t bit_pos,
+                          uint32_t width) {
+  assert(width <= 64);
+
+  uint64_t out = 0;
+  uint32_t done = 0;
+  while (done < width) {
+    uint32_t pos = bit_pos + done;
+    uint32_t offset = pos % 8;
+    uint32_t to_take = std::min(8 - offset, width - done);
+    uint64_t bits = (bytes[pos / 8] >> offset) & ((1u << to_take) - 1);
+    out |= bits << done;
+    done += to_take;
   }
-
   return out;
 }
 
-// Reverse bits from incoming byte vector
-static std::vector<uint8_t> scramble_flip_layer(const std::vector<uint8_t> &in,
-                                                uint32_t bit_width) {
-  assert(in.size() == ((bit_width + 7) / 8));
-  std::vector<uint8_t> out(in.size(), 0);
-
-  for (uint32_t i = 0; i < bit_width; ++i) {
-    or_vector_bit(out, bit_width - i - 1, read_vector_bit(in, i));
+// Replace width <= 64 bits, starting at bit bit_pos, of little-endian bytes
+// with the bottom bits of val
+static void write_bits(uint8_t *bytes, uint32_t bit_pos, uint32_t width,
+                       uint64_t val) {
+  assert(width <= 64);
+
+  uint32_t done = 0;
+  while (done < width) {
+    uint32_t pos = bit_pos + done;
+    uint32_t offset = pos % 8;
+    uint32_t to_take = std::min(8 - offset, width - done);
+    uint8_t mask = ((1u << to_take) - 1) << offset;
+    uint8_t bits = (val >> done) << offset;
+    bytes[pos / 8] = (bytes[pos / 8] & ~mask) | (bits & mask);
+    done += to_take;
   }
+}
 
-  return out;
+// Run each 4-bit chunk of the bottom bit_width bits of `in` through the SBOX.
+// Where `bit_width` isn't a multiple of 4 the remaining bits are just copied
+// straight through.
+static uint64_t scramble_sbox_layer(uint64_t in, uint32_t bit_width,
+                                    const uint8_t sbox8[256]) {
+  uint64_t sbox_mask = width_mask(bit_width & ~3u);
+  return (lookup_bytes(in, sbox8) & sbox_mask) | (in & ~sbox_mask);
 }
 
-// Apply butterfly to incoming byte vector. Even bits are placed in the lower
-// half of the output, odd bits are placed in the upper half of the output.
-static std::vector<uint8_t> scramble_perm_layer(const std::vector<uint8_t> &in,
-                                                uint32_t bit_width,
-                                                bool invert) {
-  assert(in.size() == ((bit_width + 7) / 8));
-  std::vector<uint8_t> out(in.size(), 0);
-
-  for (uint32_t i = 0; i < bit_width / 2; ++i) {
-    if (invert) {
-      or_vector_bit(out, i * 2, read_vector_bit(in, i));
-      or_vector_bit(out, i * 2 + 1, read_vector_bit(in, i + (bit_width / 2)));
-    } else {
-      or_vector_bit(out, i, read_vector_bit(in, i * 2));
-      or_vector_bit(out, i + (bit_width / 2), read_vector_bit(in, i * 2 + 1));
-    }
-  }
+// Reverse the bottom bit_width bits of `in`
+static uint64_t scramble_flip_layer(uint64_t in, uint32_t bit_width) {
+  assert(0 < bit_width);
+  return reverse_bits64(in) >> (64 - bit_width);
+}
 
-  if (bit_width % 2) {
-    // Where bit_width isn't even, the final bit is copied across to the same
-    // position
-    or_vector_bit(out, bit_width - 1, read_vector_bit(in, bit_width - 1));
+// Apply butterfly to the bottom bit_width bits of `in`. Even bits are placed
+// in the lower half of the output, odd bits are placed in the upper half of
+// the output. Where bit_width isn't even, the final bit is copied across to
+// the same position.
+static uint64_t scramble_perm_layer(uint64_t in, uint32_t bit_width,
+                                    bool invert) {
+  uint32_t half_width = bit_width / 2;
+  uint64_t top_bit =
+      (bit_width % 2) ? in & ((uint64_t)1 << (bit_width - 1)) : 0;
+
+  if (invert) {
+    uint64_t lo = in & width_mask(half_width);
+    uint64_t hi = (in >> half_width) & width_mask(half_width);
+    return spread_even_bits(lo) | (spread_even_bits(hi) << 1) | top_bit;
   }
 
-  return out;
+  uint64_t pairs = in & width_mask(2 * half_width);
+  return compress_even_bits(pairs) |
+         (compress_even_bits(pairs >> 1) << half_width) | top_bit;
 }
 
 // Apply a full set of subsitution/permutation rounds for encrypt to the
-// incoming byte vector
-static std::vector<uint8_t> scramble_subst_perm_enc(
-    const std::vector<uint8_t> &in, const std::vector<uint8_t> &key,
-    uint32_t bit_width, uint32_t num_rounds) {
-  assert(in.size() == ((bit_width + 7) / 8));
-  assert(key.size() == ((bit_width + 7) / 8));
-
-  std::vector<uint8_t> state(in);
+// bottom bit_width bits of `in`
+static uint64_t scramble_subst_perm_enc(uint64_t in, uint64_t key,
+                                        uint32_t bit_width,
+                                        uint32_t num_rounds) {
+  const uint8_t *sbox8 = GetTables().present_sbox8;
+  uint64_t state = in;
 
   for (uint32_t i = 0; i < num_rounds; ++i) {
-    state = xor_vectors(state, key);
+    state ^= key;
 
-    state = scramble_sbox_layer(state, bit_width, PRESENT_SBOX4);
+    state = scramble_sbox_layer(state, bit_width, sbox8);
     state = scramble_flip_layer(state, bit_width);
     state = scramble_perm_layer(state, bit_width, false);
   }
 
-  state = xor_vectors(state, key);
-
-  return state;
+  return state ^ key;
 }
 
 // Apply a full set of substitution/permutation rounds for decrypt to the
-// incoming byte vector
-static std::vector<uint8_t> scramble_subst_perm_dec(
-    const std::vector<uint8_t> &in, const std::vector<uint8_t> &key,
-    uint32_t bit_width, uint32_t num_rounds) {
-  assert(in.size() == ((bit_width + 7) / 8));
-  assert(key.size() == ((bit_width + 7) / 8));
-
-  std::vector<uint8_t> state(in);
+// bottom bit_width bits of `in`
+static uint64_t scramble_subst_perm_dec(uint64_t in, uint64_t key,
+                                        uint32_t bit_width,
+                                        uint32_t num_rounds) {
+  const uint8_t *sbox8_inv = GetTables().present_sbox8_inv;
+  uint64_t state = in;
 
   for (uint32_t i = 0; i < num_rounds; ++i) {
-    state = xor_vectors(state, key);
+    state ^= key;
 
     state = scramble_perm_layer(state, bit_width, true);
     state = scramble_flip_layer(state, bit_width);
-    state = scramble_sbox_layer(state, bit_width, PRESENT_SBOX4_INV);
+    state = scramble_sbox_layer(state, bit_width, sbox8_inv);
   }
 
-  state = xor_vectors(state, key);
-
-  return state;
+  return state ^ key;
 }
 
-// Generate a keystream for XORing with data using PRINCE.
-// If repeat_keystream is set to true, the output from one PRINCE instance is
-// repeated when the keystream is greater than a single PRINCE width (64bit).
-// Otherwise, multiple PRINCEs are instantiated to form the keystream.
-static std::vector<uint8_t> scramble_gen_keystream(
-    const std::vector<uint8_t> &addr, uint32_t addr_width,
-    const std::vector<uint8_t> &nonce, const std::vector<uint8_t> &key,
-    uint32_t keystream_width, uint32_t num_half_rounds, bool repeat_keystream) {
-  assert(key.size() == (kPrinceWidthByte * 2));
-
-  // Determine how many PRINCE replications are required
-  uint32_t num_princes, num_repetitions;
-  if (repeat_keystream) {
-    num_princes = 1;
-    num_repetitions = (keystream_width + kPrinceWidth - 1) / kPrinceWidth;
-  } else {
-    num_princes = (keystream_width + kPrinceWidth - 1) / kPrinceWidth;
-    num_repetitions = 1;
+// The PRINCE M' layer: M0 and M1 applied to each 16-bit chunk
+static uint64_t prince_m_prime_layer(uint64_t in) {
+  const uint16_t(*m16)[2][256] = GetTables().prince_m16;
+  // The outer chunks use M0, the inner ones M1
+  static const int kChunkMatrix[4] = {0, 1, 1, 0};
+
+  uint64_t out = 0;
+  for (int i = 0; i < 4; ++i) {
+    const uint16_t(*m)[256] = m16[kChunkMatrix[i]];
+    uint64_t chunk = m[0][(in >> (16 * i)) & 0xff] ^
+                     m[1][(in >> (16 * i + 8)) & 0xff];
+    out |= chunk << (16 * i);
   }
+  return out;
+}
 
-  std::vector<uint8_t> keystream;
-
-  for (uint32_t i = 0; i < num_princes; ++i) {
-    // Initial vector is data for PRINCE to encrypt. Formed from nonce and data
-    // address
-    std::vector<uint8_t> iv(8, 0);
-
-    for (uint32_t j = 0; j < kPrinceWidth; ++j) {
-      if (j < addr_width) {
-        // Bottom addr_width bits of IV are address
-        or_vector_bit(iv, j, read_vector_bit(addr, j));
-      } else {
-        // Other bits are taken from nonce. Each PRINCE instantiation will use
-        // different nonce bits.
-        int nonce_bit = (j - addr_width) + i * (kPrinceWidth - addr_width);
-        or_vector_bit(iv, j, read_vector_bit(nonce, nonce_bit));
-      }
-    }
-
-    // PRINCE C reference model works on big-endian byte order
-    iv = byte_reverse_vector(iv);
-    auto key_be = byte_reverse_vector(key);
-
-    // Apply PRINCE to IV to produce keystream
-    std::vector<uint8_t> keystream_block(kPrinceWidthByte);
-    prince_enc_dec(&iv[0], &key_be[0], &keystream_block[0], 0, num_half_rounds,
-                   0);
-
-    // Flip keystream into little endian order and add to keystream vector
-    keystream_block = byte_reverse_vector(keystream_block);
-    // Repeat the output of a single PRINCE instance if needed
-    for (uint32_t k = 0; k < num_repetitions; ++k) {
-      keystream.insert(keystream.end(), keystream_block.begin(),
-                       keystream_block.end());
-    }
+// The PRINCE shift rows step (and its inverse): the nibbles of row i (at bit
+// 4 * (3 - i) of each 16-bit chunk) rotate by i chunks.
+static uint64_t prince_shift_rows(uint64_t in, bool inverse) {
+  const uint64_t row_mask = 0xF000F000F000F000;
+  uint64_t out = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    uint64_t row = in & (row_mask >> (4 * i));
+    out |= rotl64(row, inverse ? 64 - 16 * i : 16 * i);
   }
+  return out;
+}
 
-  // Total keystream bits generated are some multiple of kPrinceWidth. This can
-  // result in unused keystream bits. Remove the unused bytes from the keystream
-  // vector and zero out top unused bits in the final byte if required.
-  uint32_t keystream_bytes = (keystream_width + 7) / 8;
-  uint32_t keystream_bytes_to_erase = keystream.size() - keystream_bytes;
-  if (keystream_bytes_to_erase) {
-    keystream.erase(keystream.end() - keystream_bytes_to_erase,
-                    keystream.end());
+// PRINCE encryption with the key schedule used by the memory scrambling
+// hardware (k0 for the odd forward rounds, k1 for the even ones)
+static uint64_t prince_encrypt(uint64_t input, uint64_t k0, uint64_t k1,
+                               uint32_t num_half_rounds) {
+  const ScrambleTables &tables = GetTables();
+  const uint64_t k0_prime = ((k0 >> 1) | (k0 << 63)) ^ (k0 >> 63);
+
+  uint64_t state = input ^ k0 ^ k1 ^ PRINCE_RC[0];
+  for (uint32_t round = 1; round <= num_half_rounds; ++round) {
+    state = lookup_bytes(state, tables.prince_sbox8);
+    state = prince_shift_rows(prince_m_prime_layer(state), false);
+    state ^= ((round % 2) ? k0 : k1) ^ PRINCE_RC[round];
   }
 
-  if (keystream_width % 8) {
-    keystream[keystream.size() - 1] &= (1 << (keystream_width % 8)) - 1;
+  state = lookup_bytes(state, tables.prince_sbox8);
+  state = prince_m_prime_layer(state);
+  state = lookup_bytes(state, tables.prince_sbox8_inv);
+
+  for (uint32_t round = 1; round <= num_half_rounds; ++round) {
+    uint32_t constant_idx = 10 - num_half_rounds + round;
+    state ^= (((num_half_rounds + round + 1) % 2) ? k0 : k1) ^
+             PRINCE_RC[constant_idx];
+    state = prince_m_prime_layer(prince_shift_rows(state, true));
+    state = lookup_bytes(state, tables.prince_sbox8_inv);
   }
 
-  return keystream;
+  return state ^ k1 ^ PRINCE_RC[11] ^ k0_prime;
 }
 
-// Split incoming data into subst_perm_width chunks and individually apply the
-// substitution/permutation layer to each
-static std::vector<uint8_t> scramble_subst_perm_full_width(
-    const std::vector<uint8_t> &in, uint32_t bit_width,
-    uint32_t subst_perm_width, bool enc) {
-  assert(in.size() == ((bit_width + 7) / 8));
+// Generate keystream word `word` (bits 64 * word and up) for XORing with
+// data using PRINCE.
+//
+// If repeat_keystream is set to true, the output from one PRINCE instance is
+// repeated when the keystream is greater than a single PRINCE width (64bit).
+// Otherwise, multiple PRINCEs are instantiated to form the keystream.
+static uint64_t scramble_gen_keystream_word(uint64_t addr, uint32_t addr_width,
+                                            const uint8_t *nonce, uint64_t k0,
+                                            uint64_t k1, uint32_t word,
+                                            uint32_t num_half_rounds,
+                                            bool repeat_keystream) {
+  assert(addr_width < kPrinceWidth);
+  uint32_t prince_idx = repeat_keystream ? 0 : word;
+
+  // Initial vector is data for PRINCE to encrypt. The bottom addr_width bits
+  // are the data address, the other bits are taken from nonce. Each PRINCE
+  // instantiation will use different nonce bits.
+  uint32_t nonce_bits = kPrinceWidth - addr_width;
+  uint64_t iv = addr | (read_bits(nonce, prince_idx * nonce_bits, nonce_bits)
+                        << addr_width);
+
+  return prince_encrypt(iv, k0, k1, num_half_rounds);
+}
 
-  // Determine how many bytes each subst_perm_width chunk is and how many
-  // chunks are needed to cover the full bit_width.
-  uint32_t subst_perm_bytes = (subst_perm_width + 7) / 8;
-  uint32_t subst_perm_blocks =
-      (bit_width + subst_perm_width - 1) / subst_perm_width;
+// XOR the bottom data_width bits of data with the keystream for addr
+static void scramble_xor_keystream(uint8_t *data, uint32_t data_width,
+                                   uint64_t addr, uint32_t addr_width,
+                                   const uint8_t *nonce, uint64_t k0,
+                                   uint64_t k1, bool repeat_keystream) {
+  uint64_t keystream = 0;
+  for (uint32_t word = 0; word * kPrinceWidth < data_width; ++word) {
+    // A repeated keystream only needs one PRINCE run
+    if (!repeat_keystream || word == 0) {
+      keystream = scramble_gen_keystream_word(addr, addr_width, nonce, k0, k1,
+                                              word, kNumPrinceHalfRounds,
+                                              repeat_keystream);
+    }
 
-  std::vector<uint8_t> out(in.size(), 0);
-  std::vector<uint8_t> zero_key(subst_perm_bytes, 0);
+    uint32_t bit_pos = word * kPrinceWidth;
+    uint32_t width = std::min(kPrinceWidth, data_width - bit_pos);
+    write_bits(data, bit_pos, width,
+               read_bits(data, bit_pos, width) ^ keystream);
+  }
+}
+
+// Split the bottom bit_width bits of data into subst_perm_width chunks and
+// individually apply the substitution/permutation layer to each. Bits above
+// bit_width are cleared.
+static void scramble_subst_perm_full_width(uint8_t *data, uint32_t bit_width,
+                                           uint32_t subst_perm_width,
+                                           bool enc) {
+  assert(0 < subst_perm_width && subst_perm_width <= 64);
 
   auto sp_scrambler = enc ? scramble_subst_perm_enc : scramble_subst_perm_dec;
 
-  for (uint32_t i = 0; i < subst_perm_blocks; ++i) {
+  for (uint32_t bit_pos = 0; bit_pos < bit_width;
+       bit_pos += subst_perm_width) {
     // Where bit_width does not evenly divide into subst_perm_width the
     // final block is smaller.
-    uint32_t bits_so_far = subst_perm_width * i;
-    uint32_t block_width = std::min(subst_perm_width, bit_width - bits_so_far);
-
-    std::vector<uint8_t> subst_perm_data(subst_perm_bytes, 0);
+    uint32_t block_width = std::min(subst_perm_width, bit_width - bit_pos);
 
-    // Extract bits from in for this chunk
-    for (uint32_t j = 0; j < block_width; ++j) {
-      or_vector_bit(subst_perm_data, j,
-                    read_vector_bit(in, j + i * subst_perm_width));
-    }
+    uint64_t block = read_bits(data, bit_pos, block_width);
+    write_bits(data, bit_pos, block_width,
+               sp_scrambler(block, 0, block_width, kNumDataSubstPermRounds));
+  }
 
-    // Apply the substitution/permutation layer to the chunk
-    auto subst_perm_out = sp_scrambler(subst_perm_data, zero_key, block_width,
-                                       kNumDataSubstPermRounds);
+  if (bit_width % 8) {
+    data[bit_width / 8] &= (1 << (bit_width % 8)) - 1;
+  }
+}
 
-    // Write the result to the `out` vector
-    for (uint32_t j = 0; j < block_width; ++j) {
-      or_vector_bit(out, j + i * subst_perm_width,
-                    read_vector_bit(subst_perm_out, j));
+// Encrypt or decrypt num_words words in place, word i starting at byte
+// i * stride of data and having address addrs[i] or, if addrs is null,
+// first_addr + i
+static void scramble_words(uint8_t *data, size_t stride, uint32_t num_words,
+                           uint32_t data_width, uint32_t subst_perm_width,
+                           uint64_t first_addr, const uint32_t *addrs,
+                           uint32_t addr_width,
+                           const std::vector<uint8_t> &nonce,
+                           const std::vector<uint8_t> &key,
+                           bool repeat_keystream, bool use_sp_layer,
+                           bool enc) {
+  assert(key.size() == (kPrinceWidthByte * 2));
+  assert(addr_width < kPrinceWidth);
+
+  // The byte vector holds K1 in the lower 8 bytes and K0 in the upper ones
+  uint64_t k1 = read_bits(key.data(), 0, kPrinceWidth);
+  uint64_t k0 = read_bits(key.data(), kPrinceWidth, kPrinceWidth);
+  uint64_t addr_mask = width_mask(addr_width);
+
+  for (uint32_t i = 0; i < num_words; ++i) {
+    uint8_t *word = data + i * stride;
+    uint64_t addr = (addrs ? addrs[i] : first_addr + i) & addr_mask;
+
+    // Data is encrypted by XORing with keystream then applying
+    // substitution/permutation layer. Decryption reverses this.
+    if (enc) {
+      scramble_xor_keystream(word, data_width, addr, addr_width, nonce.data(),
+                             k0, k1, repeat_keystream);
+    }
+    if (use_sp_layer) {
+      scramble_subst_perm_full_width(word, data_width, subst_perm_width, enc);
+    }
+    if (!enc) {
+      scramble_xor_keystream(word, data_width, addr, addr_width, nonce.data(),
+                             k0, k1, repeat_keystream);
     }
   }
-
-  return out;
 }
 
 std::vector<uint8_t> scramble_addr(const std::vector<uint8_t> &addr_in,
@@ -302,20 +426,35 @@ std::vector<uint8_t> scramble_addr(const std::vector<uint8_t> &addr_in,
                                    const std::vector<uint8_t> &nonce,
                                    uint32_t nonce_width) {
   assert(addr_in.size() == ((addr_width + 7) / 8));
-
-  std::vector<uint8_t> addr_enc_nonce(addr_in.size(), 0);
+  assert(addr_width <= 64 && addr_width <= nonce_width);
 
   // Address is scrambled by using substitution/permutation layer with the nonce
   // used as a key.
-  // Extract relevant nonce bits for key
-  for (uint32_t i = 0; i < addr_width; ++i) {
-    or_vector_bit(addr_enc_nonce, i,
-                  read_vector_bit(nonce, nonce_width - addr_width + i));
-  }
+  uint64_t key = read_bits(nonce.data(), nonce_width - addr_width, addr_width);
+  uint64_t addr = read_bits(addr_in.data(), 0, addr_width);
+
+  std::vector<uint8_t> addr_out(addr_in.size(), 0);
+  write_bits(addr_out.data(), 0, addr_width,
+             scramble_subst_perm_enc(addr, key, addr_width,
+                                     kNumAddrSubstPermRounds));
+  return addr_out;
+}
+
+std::vector<uint32_t> scramble_addr_table(uint32_t num_addrs,
+                                          uint32_t addr_width,
+                                          const std::vector<uint8_t> &nonce,
+                                          uint32_t nonce_width) {
+  assert(addr_width <= 32 && addr_width <= nonce_width);
+  assert(addr_width == 32 || num_addrs <= ((uint64_t)1 << addr_width));
 
-  // Apply substitution/permutation layer
-  return scramble_subst_perm_enc(addr_in, addr_enc_nonce, addr_width,
-                                 kNumAddrSubstPermRounds);
+  uint64_t key = read_bits(nonce.data(), nonce_width - addr_width, addr_width);
+
+  std::vector<uint32_t> table(num_addrs);
+  for (uint32_t addr = 0; addr < num_addrs; ++addr) {
+    table[addr] = scramble_subst_perm_enc(addr, key, addr_width,
+                                          kNumAddrSubstPermRounds);
+  }
+  return table;
 }
 
 std::vector<uint8_t> scramble_encrypt_data(
@@ -326,21 +465,11 @@ std::vector<uint8_t> scramble_encrypt_data(
   assert(data_in.size() == ((data_width + 7) / 8));
   assert(addr.size() == ((addr_width + 7) / 8));
 
-  // Data is encrypted by XORing with keystream then applying
-  // substitution/permutation layer
-
-  auto keystream =
-      scramble_gen_keystream(addr, addr_width, nonce, key, data_width,
-                             kNumPrinceHalfRounds, repeat_keystream);
-
-  auto data_enc = xor_vectors(data_in, keystream);
-
-  if (use_sp_layer) {
-    return scramble_subst_perm_full_width(data_enc, data_width,
-                                          subst_perm_width, true);
-  } else {
-    return data_enc;
-  }
+  std::vector<uint8_t> data(data_in);
+  scramble_words(data.data(), data.size(), 1, data_width, subst_perm_width,
+                 read_bits(addr.data(), 0, addr_width), nullptr, addr_width,
+                 nonce, key, repeat_keystream, use_sp_layer, true);
+  return data;
 }
 
 std::vector<uint8_t> scramble_decrypt_data(
@@ -351,16 +480,59 @@ std::vector<uint8_t> scramble_decrypt_data(
   assert(data_in.size() == ((data_width + 7) / 8));
   assert(addr.size() == ((addr_width + 7) / 8));
 
-  auto keystream =
-      scramble_gen_keystream(addr, addr_width, nonce, key, data_width,
-                             kNumPrinceHalfRounds, repeat_keystream);
-  if (use_sp_layer) {
-    // Data is decrypted by reversing substitution/permutation layer then XORing
-    // with keystream
-    auto data_sp_out = scramble_subst_perm_full_width(data_in, data_width,
-                                                      subst_perm_width, false);
-    return xor_vectors(data_sp_out, keystream);
-  } else {
-    return xor_vectors(data_in, keystream);
-  }
+  std::vector<uint8_t> data(data_in);
+  scramble_words(data.data(), data.size(), 1, data_width, subst_perm_width,
+                 read_bits(addr.data(), 0, addr_width), nullptr, addr_width,
+                 nonce, key, repeat_keystream, use_sp_layer, false);
+  return data;
+}
+
+void scramble_encrypt_words(uint8_t *data, size_t stride, uint32_t num_words,
+                            uint32_t data_width, uint32_t subst_perm_width,
+                            uint64_t first_addr, uint32_t addr_width,
+                            const std::vector<uint8_t> &nonce,
+                            const std::vector<uint8_t> &key,
+                            bool repeat_keystream, bool use_sp_layer) {
+  assert(stride >= (data_width + 7) / 8);
+  scramble_words(data, stride, num_words, data_width, subst_perm_width,
+                 first_addr, nullptr, addr_width, nonce, key,
+                 repeat_keystream, use_sp_layer, true);
+}
+
+void scramble_decrypt_words(uint8_t *data, size_t stride, uint32_t num_words,
+                            uint32_t data_width, uint32_t subst_perm_width,
+                            uint64_t first_addr, uint32_t addr_width,
+                            const std::vector<uint8_t> &nonce,
+                            const std::vector<uint8_t> &key,
+                            bool repeat_keystream, bool use_sp_layer) {
+  assert(stride >= (data_width + 7) / 8);
+  scramble_words(data, stride, num_words, data_width, subst_perm_width,
+                 first_addr, nullptr, addr_width, nonce, key,
+                 repeat_keystream, use_sp_layer, false);
+}
+
+void scramble_encrypt_words_at(uint8_t *data, size_t stride,
+                               uint32_t num_words, uint32_t data_width,
+                               uint32_t subst_perm_width, const uint32_t *addrs,
+                               uint32_t addr_width,
+                               const std::vector<uint8_t> &nonce,
+                               const std::vector<uint8_t> &key,
+                               bool repeat_keystream, bool use_sp_layer) {
+  assert(stride >= (data_width + 7) / 8);
+  scramble_words(data, stride, num_words, data_width, subst_perm_width, 0,
+                 addrs, addr_width, nonce, key, repeat_keystream, use_sp_layer,
+                 true);
+}
+
+void scramble_decrypt_words_at(uint8_t *data, size_t stride,
+                               uint32_t num_words, uint32_t data_width,
+                               uint32_t subst_perm_width, const uint32_t *addrs,
+                               uint32_t addr_width,
+                               const std::vector<uint8_t> &nonce,
+                               const std::vector<uint8_t> &key,
+                               bool repeat_keystream, bool use_sp_layer) {
+  assert(stride >= (data_width + 7) / 8);
+  scramble_words(data, stride, num_words, data_width, subst_perm_width, 0,
+                 addrs, addr_width, nonce, key, repeat_keystream, use_sp_layer,
+                 false);
 }
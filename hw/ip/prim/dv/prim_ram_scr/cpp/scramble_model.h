@@ -5,6 +5,7 @@
 #ifndef OPENTITAN_HW_IP_PRIM_DV_PRIM_RAM_SCR_CPP_SCRAMBLE_MODEL_H_
 #define OPENTITAN_HW_IP_PRIM_DV_PRIM_RAM_SCR_CPP_SCRAMBLE_MODEL_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
@@ -18,7 +19,8 @@ const uint32_t kPrinceWidthByte = kPrinceWidth / 8;
  * scrambled memory. Return vector of scrambled address bytes
  *
  * @param addr_in      Byte vector of address
- * @param addr_width   Width of the address in bits
+ * @param addr_width   Width of the address in bits (at most 64 and at most
+ *                     nonce_width)
  * @param nonce        Byte vector of scrambling nonce
  * @param nonce_width  Width of scramble nonce in bits
  * @return Byte vector with scrambled address
@@ -28,13 +30,32 @@ std::vector<uint8_t> scramble_addr(const std::vector<uint8_t> &addr_in,
                                    const std::vector<uint8_t> &nonce,
                                    uint32_t nonce_width);
 
+/** Scramble the addresses 0 to num_addrs - 1, like scramble_addr() does for
+ * a single address. Return a table with the scrambled address of each
+ *
+ * This reads the nonce once for all addresses, so it's much cheaper than
+ * calling scramble_addr() for each of them.
+ *
+ * @param num_addrs    Number of addresses to scramble (at most 2^addr_width)
+ * @param addr_width   Width of the address in bits (at most 32 and at most
+ *                     nonce_width)
+ * @param nonce        Byte vector of scrambling nonce
+ * @param nonce_width  Width of scramble nonce in bits
+ * @return Vector with the scrambled address of each address
+ */
+std::vector<uint32_t> scramble_addr_table(uint32_t num_addrs,
+                                          uint32_t addr_width,
+                                          const std::vector<uint8_t> &nonce,
+                                          uint32_t nonce_width);
+
 /** Decrypt scrambled data
  * @param data_in          Byte vector of data to decrypt
  * @param data_width       Width of data in bits
  * @param subst_perm_width Width over which the substitution/permutation network
- *                         is applied (DiffWidth parameter on prim_ram_1p_scr)
+ *                         is applied (DiffWidth parameter on prim_ram_1p_scr),
+ *                         at most 64 bits
  * @param addr             Byte vector of data address
- * @param addr_width       Width of the address in bits
+ * @param addr_width       Width of the address in bits (less than 64)
  * @param nonce            Byte vector of scrambling nonce
  * @param key              Byte vector of scrambling key
  * @param repeat_keystream Repeat the keystream of one single PRINCE instance if
@@ -56,9 +77,10 @@ std::vector<uint8_t> scramble_decrypt_data(
  * @param data_in          Byte vector of data to encrypt
  * @param data_width       Width of data in bits
  * @param subst_perm_width Width over which the substitution/permutation network
- *                         is applied (DiffWidth parameter on prim_ram_1p_scr)
+ *                         is applied (DiffWidth parameter on prim_ram_1p_scr),
+ *                         at most 64 bits
  * @param addr             Byte vector of data address
- * @param addr_width       Width of the address in bits
+ * @param addr_width       Width of the address in bits (less than 64)
  * @param nonce            Byte vector of scrambling nonce
  * @param key              Byte vector of scrambling key
  * @param repeat_keystream Repeat the keystream of one single PRINCE instance if
@@ -76,4 +98,66 @@ std::vector<uint8_t> scramble_encrypt_data(
     uint32_t addr_width, const std::vector<uint8_t> &nonce,
     const std::vector<uint8_t> &key, bool repeat_keystream, bool use_sp_layer);
 
+/** Decrypt num_words scrambled words in place
+ *
+ * This is equivalent to calling scramble_decrypt_data() for each word, but
+ * works in place and reads the key once for all words, so it's cheaper for
+ * ranges of memory words.
+ *
+ * @param data             Buffer with the words to decrypt. Word i starts at
+ *                         byte i * stride and has (data_width + 7) / 8 bytes
+ *                         in little endian byte order.
+ * @param stride           Distance between the starts of words in bytes
+ * @param num_words        Number of words
+ * @param first_addr       Address of the first word. Word i has address
+ *                         first_addr + i, truncated to addr_width bits.
+ *
+ * The other parameters are as for scramble_decrypt_data().
+ */
+void scramble_decrypt_words(uint8_t *data, size_t stride, uint32_t num_words,
+                            uint32_t data_width, uint32_t subst_perm_width,
+                            uint64_t first_addr, uint32_t addr_width,
+                            const std::vector<uint8_t> &nonce,
+                            const std::vector<uint8_t> &key,
+                            bool repeat_keystream, bool use_sp_layer);
+
+/** Encrypt num_words words in place
+ *
+ * This is equivalent to calling scramble_encrypt_data() for each word. The
+ * layout of data and the meaning of the parameters are as for
+ * scramble_decrypt_words().
+ */
+void scramble_encrypt_words(uint8_t *data, size_t stride, uint32_t num_words,
+                            uint32_t data_width, uint32_t subst_perm_width,
+                            uint64_t first_addr, uint32_t addr_width,
+                            const std::vector<uint8_t> &nonce,
+                            const std::vector<uint8_t> &key,
+                            bool repeat_keystream, bool use_sp_layer);
+
+/** Decrypt num_words words in place, which needn't have consecutive addresses
+ *
+ * This is like scramble_decrypt_words(), but word i has address addrs[i],
+ * truncated to addr_width bits, so that words can be decrypted in the order
+ * of their physical address.
+ */
+void scramble_decrypt_words_at(uint8_t *data, size_t stride,
+                               uint32_t num_words, uint32_t data_width,
+                               uint32_t subst_perm_width, const uint32_t *addrs,
+                               uint32_t addr_width,
+                               const std::vector<uint8_t> &nonce,
+                               const std::vector<uint8_t> &key,
+                               bool repeat_keystream, bool use_sp_layer);
+
+/** Encrypt num_words words in place, word i having address addrs[i]
+ *
+ * See scramble_decrypt_words_at().
+ */
+void scramble_encrypt_words_at(uint8_t *data, size_t stride,
+                               uint32_t num_words, uint32_t data_width,
+                               uint32_t subst_perm_width, const uint32_t *addrs,
+                               uint32_t addr_width,
+                               const std::vector<uint8_t> &nonce,
+                               const std::vector<uint8_t> &key,
+                               bool repeat_keystream, bool use_sp_layer);
+
 #endif  // OPENTITAN_HW_IP_PRIM_DV_PRIM_RAM_SCR_CPP_SCRAMBLE_MODEL_H_
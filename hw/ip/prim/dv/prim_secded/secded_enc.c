@@ -8,21 +8,23 @@
 #include "secded_enc.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 // Calculates even parity for a 64-bit word
-static uint8_t calc_parity(uint64_t word, bool invert) {
-  bool parity = false;
+static inline uint8_t calc_parity(uint64_t word, bool invert) {
+#if defined(__GNUC__)
+  return __builtin_parityll(word) ^ invert;
+#else
+  word ^= word >> 32;
+  word ^= word >> 16;
+  word ^= word >> 8;
+  word ^= word >> 4;
+  word ^= word >> 2;
+  word ^= word >> 1;
 
-  while (word) {
-    if (word & 1) {
-      parity = !parity;
-    }
-
-    word >>= 1;
-  }
-
-  return parity ^ invert;
+  return (word & 1) ^ invert;
+#endif
 }
 
 uint8_t enc_secded_22_16(const uint8_t bytes[2]) {
@@ -36,6 +38,33 @@ uint8_t enc_secded_22_16(const uint8_t bytes[2]) {
          (calc_parity(word & 0x11f3, false) << 5);
 }
 
+void enc_secded_22_16_buf(const uint8_t *bytes, uint8_t *ecc,
+                          size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_22_16(&bytes[2 * i]);
+  }
+}
+
+uint8_t dec_secded_22_16(uint8_t bytes[2], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[16] = {
+      0x32, 0x23, 0x19, 0x7, 0x2c, 0x31, 0x25, 0x34, 0x29, 0xe, 0x1c, 0x15,
+      0x2a, 0x1a, 0xb, 0x16};
+
+  uint8_t syndrome = enc_secded_22_16(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 16; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_28_22(const uint8_t bytes[3]) {
   uint32_t word = ((uint32_t)bytes[0] << 0) | ((uint32_t)bytes[1] << 8) |
                   ((uint32_t)bytes[2] << 16);
@@ -48,6 +77,33 @@ uint8_t enc_secded_28_22(const uint8_t bytes[3]) {
          (calc_parity(word & 0x3ed348, false) << 5);
 }
 
+void enc_secded_28_22_buf(const uint8_t *bytes, uint8_t *ecc,
+                          size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_28_22(&bytes[3 * i]);
+  }
+}
+
+uint8_t dec_secded_28_22(uint8_t bytes[3], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[22] = {
+      0x7, 0xb, 0x13, 0x23, 0xd, 0x15, 0x25, 0x19, 0x29, 0x31, 0xe, 0x16, 0x26,
+      0x1a, 0x2a, 0x32, 0x1c, 0x2c, 0x34, 0x38, 0x3b, 0x3d};
+
+  uint8_t syndrome = enc_secded_28_22(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 22; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_39_32(const uint8_t bytes[4]) {
   uint32_t word = ((uint32_t)bytes[0] << 0) | ((uint32_t)bytes[1] << 8) |
                   ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
@@ -61,6 +117,34 @@ uint8_t enc_secded_39_32(const uint8_t bytes[4]) {
          (calc_parity(word & 0x98505586, false) << 6);
 }
 
+void enc_secded_39_32_buf(const uint8_t *bytes, uint8_t *ecc,
+                          size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_39_32(&bytes[4 * i]);
+  }
+}
+
+uint8_t dec_secded_39_32(uint8_t bytes[4], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[32] = {
+      0x19, 0x54, 0x61, 0x34, 0x1a, 0x15, 0x2a, 0x4c, 0x45, 0x38, 0x49, 0xd,
+      0x51, 0x31, 0x68, 0x7, 0x1c, 0xb, 0x25, 0x26, 0x46, 0xe, 0x70, 0x32, 0x2c,
+      0x13, 0x23, 0x62, 0x4a, 0x29, 0x16, 0x52};
+
+  uint8_t syndrome = enc_secded_39_32(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 32; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_64_57(const uint8_t bytes[8]) {
   uint64_t word = ((uint64_t)bytes[0] << 0) | ((uint64_t)bytes[1] << 8) |
                   ((uint64_t)bytes[2] << 16) | ((uint64_t)bytes[3] << 24) |
@@ -76,6 +160,36 @@ uint8_t enc_secded_64_57(const uint8_t bytes[8]) {
          (calc_parity(word & 0x1fbdda769a46910, false) << 6);
 }
 
+void enc_secded_64_57_buf(const uint8_t *bytes, uint8_t *ecc,
+                          size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_64_57(&bytes[8 * i]);
+  }
+}
+
+uint8_t dec_secded_64_57(uint8_t bytes[8], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[57] = {
+      0x7, 0xb, 0x13, 0x23, 0x43, 0xd, 0x15, 0x25, 0x45, 0x19, 0x29, 0x49, 0x31,
+      0x51, 0x61, 0xe, 0x16, 0x26, 0x46, 0x1a, 0x2a, 0x4a, 0x32, 0x52, 0x62,
+      0x1c, 0x2c, 0x4c, 0x34, 0x54, 0x64, 0x38, 0x58, 0x68, 0x70, 0x1f, 0x2f,
+      0x4f, 0x37, 0x57, 0x67, 0x3b, 0x5b, 0x6b, 0x73, 0x3d, 0x5d, 0x6d, 0x75,
+      0x79, 0x3e, 0x5e, 0x6e, 0x76, 0x7a, 0x7c, 0x7f};
+
+  uint8_t syndrome = enc_secded_64_57(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 57; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_72_64(const uint8_t bytes[8]) {
   uint64_t word = ((uint64_t)bytes[0] << 0) | ((uint64_t)bytes[1] << 8) |
                   ((uint64_t)bytes[2] << 16) | ((uint64_t)bytes[3] << 24) |
@@ -92,6 +206,37 @@ uint8_t enc_secded_72_64(const uint8_t bytes[8]) {
          (calc_parity(word & 0x7aed348d221a4420, false) << 7);
 }
 
+void enc_secded_72_64_buf(const uint8_t *bytes, uint8_t *ecc,
+                          size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_72_64(&bytes[8 * i]);
+  }
+}
+
+uint8_t dec_secded_72_64(uint8_t bytes[8], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[64] = {
+      0x7, 0xb, 0x13, 0x23, 0x43, 0x83, 0xd, 0x15, 0x25, 0x45, 0x85, 0x19, 0x29,
+      0x49, 0x89, 0x31, 0x51, 0x91, 0x61, 0xa1, 0xc1, 0xe, 0x16, 0x26, 0x46,
+      0x86, 0x1a, 0x2a, 0x4a, 0x8a, 0x32, 0x52, 0x92, 0x62, 0xa2, 0xc2, 0x1c,
+      0x2c, 0x4c, 0x8c, 0x34, 0x54, 0x94, 0x64, 0xa4, 0xc4, 0x38, 0x58, 0x98,
+      0x68, 0xa8, 0xc8, 0x70, 0xb0, 0xd0, 0xe0, 0x6d, 0xd6, 0x3e, 0xcb, 0xb3,
+      0xb5, 0xce, 0x79};
+
+  uint8_t syndrome = enc_secded_72_64(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 64; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_inv_22_16(const uint8_t bytes[2]) {
   uint16_t word = ((uint16_t)bytes[0] << 0) | ((uint16_t)bytes[1] << 8);
 
@@ -103,6 +248,33 @@ uint8_t enc_secded_inv_22_16(const uint8_t bytes[2]) {
          (calc_parity(word & 0x11f3, true) << 5);
 }
 
+void enc_secded_inv_22_16_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_inv_22_16(&bytes[2 * i]);
+  }
+}
+
+uint8_t dec_secded_inv_22_16(uint8_t bytes[2], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[16] = {
+      0x32, 0x23, 0x19, 0x7, 0x2c, 0x31, 0x25, 0x34, 0x29, 0xe, 0x1c, 0x15,
+      0x2a, 0x1a, 0xb, 0x16};
+
+  uint8_t syndrome = enc_secded_inv_22_16(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 16; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_inv_28_22(const uint8_t bytes[3]) {
   uint32_t word = ((uint32_t)bytes[0] << 0) | ((uint32_t)bytes[1] << 8) |
                   ((uint32_t)bytes[2] << 16);
@@ -115,6 +287,33 @@ uint8_t enc_secded_inv_28_22(const uint8_t bytes[3]) {
          (calc_parity(word & 0x3ed348, true) << 5);
 }
 
+void enc_secded_inv_28_22_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_inv_28_22(&bytes[3 * i]);
+  }
+}
+
+uint8_t dec_secded_inv_28_22(uint8_t bytes[3], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[22] = {
+      0x7, 0xb, 0x13, 0x23, 0xd, 0x15, 0x25, 0x19, 0x29, 0x31, 0xe, 0x16, 0x26,
+      0x1a, 0x2a, 0x32, 0x1c, 0x2c, 0x34, 0x38, 0x3b, 0x3d};
+
+  uint8_t syndrome = enc_secded_inv_28_22(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 22; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_inv_39_32(const uint8_t bytes[4]) {
   uint32_t word = ((uint32_t)bytes[0] << 0) | ((uint32_t)bytes[1] << 8) |
                   ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
@@ -128,6 +327,34 @@ uint8_t enc_secded_inv_39_32(const uint8_t bytes[4]) {
          (calc_parity(word & 0x98505586, false) << 6);
 }
 
+void enc_secded_inv_39_32_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_inv_39_32(&bytes[4 * i]);
+  }
+}
+
+uint8_t dec_secded_inv_39_32(uint8_t bytes[4], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[32] = {
+      0x19, 0x54, 0x61, 0x34, 0x1a, 0x15, 0x2a, 0x4c, 0x45, 0x38, 0x49, 0xd,
+      0x51, 0x31, 0x68, 0x7, 0x1c, 0xb, 0x25, 0x26, 0x46, 0xe, 0x70, 0x32, 0x2c,
+      0x13, 0x23, 0x62, 0x4a, 0x29, 0x16, 0x52};
+
+  uint8_t syndrome = enc_secded_inv_39_32(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 32; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_inv_64_57(const uint8_t bytes[8]) {
   uint64_t word = ((uint64_t)bytes[0] << 0) | ((uint64_t)bytes[1] << 8) |
                   ((uint64_t)bytes[2] << 16) | ((uint64_t)bytes[3] << 24) |
@@ -143,6 +370,36 @@ uint8_t enc_secded_inv_64_57(const uint8_t bytes[8]) {
          (calc_parity(word & 0x1fbdda769a46910, false) << 6);
 }
 
+void enc_secded_inv_64_57_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_inv_64_57(&bytes[8 * i]);
+  }
+}
+
+uint8_t dec_secded_inv_64_57(uint8_t bytes[8], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[57] = {
+      0x7, 0xb, 0x13, 0x23, 0x43, 0xd, 0x15, 0x25, 0x45, 0x19, 0x29, 0x49, 0x31,
+      0x51, 0x61, 0xe, 0x16, 0x26, 0x46, 0x1a, 0x2a, 0x4a, 0x32, 0x52, 0x62,
+      0x1c, 0x2c, 0x4c, 0x34, 0x54, 0x64, 0x38, 0x58, 0x68, 0x70, 0x1f, 0x2f,
+      0x4f, 0x37, 0x57, 0x67, 0x3b, 0x5b, 0x6b, 0x73, 0x3d, 0x5d, 0x6d, 0x75,
+      0x79, 0x3e, 0x5e, 0x6e, 0x76, 0x7a, 0x7c, 0x7f};
+
+  uint8_t syndrome = enc_secded_inv_64_57(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 57; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
+
 uint8_t enc_secded_inv_72_64(const uint8_t bytes[8]) {
   uint64_t word = ((uint64_t)bytes[0] << 0) | ((uint64_t)bytes[1] << 8) |
                   ((uint64_t)bytes[2] << 16) | ((uint64_t)bytes[3] << 24) |
@@ -158,3 +415,34 @@ uint8_t enc_secded_inv_72_64(const uint8_t bytes[8]) {
          (calc_parity(word & 0xcbdaaa4a91152210, false) << 6) |
          (calc_parity(word & 0x7aed348d221a4420, true) << 7);
 }
+
+void enc_secded_inv_72_64_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words) {
+  for (size_t i = 0; i < num_words; ++i) {
+    ecc[i] = enc_secded_inv_72_64(&bytes[8 * i]);
+  }
+}
+
+uint8_t dec_secded_inv_72_64(uint8_t bytes[8], uint8_t ecc) {
+  static const uint8_t kDataSyndromes[64] = {
+      0x7, 0xb, 0x13, 0x23, 0x43, 0x83, 0xd, 0x15, 0x25, 0x45, 0x85, 0x19, 0x29,
+      0x49, 0x89, 0x31, 0x51, 0x91, 0x61, 0xa1, 0xc1, 0xe, 0x16, 0x26, 0x46,
+      0x86, 0x1a, 0x2a, 0x4a, 0x8a, 0x32, 0x52, 0x92, 0x62, 0xa2, 0xc2, 0x1c,
+      0x2c, 0x4c, 0x8c, 0x34, 0x54, 0x94, 0x64, 0xa4, 0xc4, 0x38, 0x58, 0x98,
+      0x68, 0xa8, 0xc8, 0x70, 0xb0, 0xd0, 0xe0, 0x6d, 0xd6, 0x3e, 0xcb, 0xb3,
+      0xb5, 0xce, 0x79};
+
+  uint8_t syndrome = enc_secded_inv_72_64(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {
+    return syndrome ? 2 : 0;
+  }
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < 64; ++i) {
+    if (syndrome == kDataSyndromes[i]) {
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }
+  }
+  return 1;
+}
@@ -8,6 +8,7 @@
 #ifndef OPENTITAN_HW_IP_PRIM_DV_PRIM_SECDED_SECDED_ENC_H_
 #define OPENTITAN_HW_IP_PRIM_DV_PRIM_SECDED_SECDED_ENC_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -17,17 +18,60 @@ extern "C" {
 // Integrity encode functions for varying bit widths matching the functionality
 // of the RTL modules of the same name. Each takes an array of bytes in
 // little-endian order and returns the calculated integrity bits.
+//
+// The enc_*_buf functions encode num_words words, stored one after the other
+// in the same format, and write the integrity bits of each word to ecc.
+//
+// The dec_* functions match the RTL decoders. Each takes an array of bytes in
+// little-endian order and the integrity bits stored with them. A single bit
+// error in the data is corrected in place. They return the error flags of the
+// RTL decoder: bit 0 is set for a single bit error and bit 1 for a double bit
+// error.
 
 uint8_t enc_secded_22_16(const uint8_t bytes[2]);
+void enc_secded_22_16_buf(const uint8_t *bytes, uint8_t *ecc, size_t num_words);
+uint8_t dec_secded_22_16(uint8_t bytes[2], uint8_t ecc);
+
 uint8_t enc_secded_28_22(const uint8_t bytes[3]);
+void enc_secded_28_22_buf(const uint8_t *bytes, uint8_t *ecc, size_t num_words);
+uint8_t dec_secded_28_22(uint8_t bytes[3], uint8_t ecc);
+
 uint8_t enc_secded_39_32(const uint8_t bytes[4]);
+void enc_secded_39_32_buf(const uint8_t *bytes, uint8_t *ecc, size_t num_words);
+uint8_t dec_secded_39_32(uint8_t bytes[4], uint8_t ecc);
+
 uint8_t enc_secded_64_57(const uint8_t bytes[8]);
+void enc_secded_64_57_buf(const uint8_t *bytes, uint8_t *ecc, size_t num_words);
+uint8_t dec_secded_64_57(uint8_t bytes[8], uint8_t ecc);
+
 uint8_t enc_secded_72_64(const uint8_t bytes[8]);
+void enc_secded_72_64_buf(const uint8_t *bytes, uint8_t *ecc, size_t num_words);
+uint8_t dec_secded_72_64(uint8_t bytes[8], uint8_t ecc);
+
 uint8_t enc_secded_inv_22_16(const uint8_t bytes[2]);
+void enc_secded_inv_22_16_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words);
+uint8_t dec_secded_inv_22_16(uint8_t bytes[2], uint8_t ecc);
+
 uint8_t enc_secded_inv_28_22(const uint8_t bytes[3]);
+void enc_secded_inv_28_22_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words);
+uint8_t dec_secded_inv_28_22(uint8_t bytes[3], uint8_t ecc);
+
 uint8_t enc_secded_inv_39_32(const uint8_t bytes[4]);
+void enc_secded_inv_39_32_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words);
+uint8_t dec_secded_inv_39_32(uint8_t bytes[4], uint8_t ecc);
+
 uint8_t enc_secded_inv_64_57(const uint8_t bytes[8]);
+void enc_secded_inv_64_57_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words);
+uint8_t dec_secded_inv_64_57(uint8_t bytes[8], uint8_t ecc);
+
 uint8_t enc_secded_inv_72_64(const uint8_t bytes[8]);
+void enc_secded_inv_72_64_buf(const uint8_t *bytes, uint8_t *ecc,
+                              size_t num_words);
+uint8_t dec_secded_inv_72_64(uint8_t bytes[8], uint8_t ecc);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -0,0 +1,161 @@
+// Copyright lowRISC contributors (OpenTitan project).
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "secded_enc.h"
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace secded_enc_unittest {
+namespace {
+
+// The generated functions of one code
+struct SecdedCode {
+  const char *name;
+  // Number of data bits (k) and of check bits (n - k)
+  uint32_t data_bits;
+  uint32_t check_bits;
+  uint8_t (*enc)(const uint8_t *bytes);
+  void (*enc_buf)(const uint8_t *bytes, uint8_t *ecc, size_t num_words);
+  uint8_t (*dec)(uint8_t *bytes, uint8_t ecc);
+
+  uint32_t Bytes() const { return (data_bits + 7) / 8; }
+};
+
+std::ostream &operator<<(std::ostream &os, const SecdedCode &code) {
+  return os << code.name;
+}
+
+#define SECDED_CODE(name, n, k) \
+  { #name, k, n - k, enc_##name, enc_##name##_buf, dec_##name }
+
+const SecdedCode kCodes[] = {
+    SECDED_CODE(secded_22_16, 22, 16),
+    SECDED_CODE(secded_28_22, 28, 22),
+    SECDED_CODE(secded_39_32, 39, 32),
+    SECDED_CODE(secded_64_57, 64, 57),
+    SECDED_CODE(secded_72_64, 72, 64),
+    SECDED_CODE(secded_inv_22_16, 22, 16),
+    SECDED_CODE(secded_inv_28_22, 28, 22),
+    SECDED_CODE(secded_inv_39_32, 39, 32),
+    SECDED_CODE(secded_inv_64_57, 64, 57),
+    SECDED_CODE(secded_inv_72_64, 72, 64),
+};
+
+// Number of random data words to check for each code
+const int kNumWords = 64;
+
+class SecdedEncTest : public testing::TestWithParam<SecdedCode> {
+ protected:
+  // Random data words, with the bits above the data bits cleared
+  std::vector<uint8_t> RandomWords(int num_words) {
+    const SecdedCode &code = GetParam();
+    std::vector<uint8_t> words((size_t)num_words * code.Bytes());
+    for (int i = 0; i < num_words; ++i) {
+      uint8_t *bytes = &words[(size_t)i * code.Bytes()];
+      for (uint32_t j = 0; j < code.Bytes(); ++j) {
+        bytes[j] = rng_();
+      }
+      if (code.data_bits % 8) {
+        bytes[code.Bytes() - 1] &= (1 << (code.data_bits % 8)) - 1;
+      }
+    }
+    return words;
+  }
+
+  std::mt19937 rng_;
+};
+
+void FlipBit(uint8_t *bytes, uint32_t bit) {
+  bytes[bit / 8] ^= 1 << (bit % 8);
+}
+
+TEST_P(SecdedEncTest, BufferMatchesWords) {
+  const SecdedCode &code = GetParam();
+  std::vector<uint8_t> words = RandomWords(kNumWords);
+  std::vector<uint8_t> ecc(kNumWords);
+  code.enc_buf(words.data(), ecc.data(), kNumWords);
+  for (int i = 0; i < kNumWords; ++i) {
+    EXPECT_EQ(ecc[i], code.enc(&words[(size_t)i * code.Bytes()]));
+  }
+}
+
+TEST_P(SecdedEncTest, NoError) {
+  const SecdedCode &code = GetParam();
+  std::vector<uint8_t> words = RandomWords(kNumWords);
+  for (int i = 0; i < kNumWords; ++i) {
+    uint8_t *bytes = &words[(size_t)i * code.Bytes()];
+    std::vector<uint8_t> decoded(bytes, bytes + code.Bytes());
+    EXPECT_EQ(code.dec(decoded.data(), code.enc(bytes)), 0);
+    EXPECT_EQ(0, memcmp(decoded.data(), bytes, code.Bytes()));
+  }
+}
+
+TEST_P(SecdedEncTest, SingleErrorsCorrected) {
+  const SecdedCode &code = GetParam();
+  std::vector<uint8_t> words = RandomWords(kNumWords);
+  for (int i = 0; i < kNumWords; ++i) {
+    uint8_t *bytes = &words[(size_t)i * code.Bytes()];
+    uint8_t ecc = code.enc(bytes);
+
+    // Errors in the data bits are corrected
+    for (uint32_t bit = 0; bit < code.data_bits; ++bit) {
+      std::vector<uint8_t> decoded(bytes, bytes + code.Bytes());
+      FlipBit(decoded.data(), bit);
+      EXPECT_EQ(code.dec(decoded.data(), ecc), 1) << "data bit " << bit;
+      EXPECT_EQ(0, memcmp(decoded.data(), bytes, code.Bytes()))
+          << "data bit " << bit;
+    }
+
+    // Errors in the check bits leave the data alone
+    for (uint32_t bit = 0; bit < code.check_bits; ++bit) {
+      std::vector<uint8_t> decoded(bytes, bytes + code.Bytes());
+      EXPECT_EQ(code.dec(decoded.data(), ecc ^ (1 << bit)), 1)
+          << "check bit " << bit;
+      EXPECT_EQ(0, memcmp(decoded.data(), bytes, code.Bytes()))
+          << "check bit " << bit;
+    }
+  }
+}
+
+TEST_P(SecdedEncTest, DoubleErrorsDetected) {
+  const SecdedCode &code = GetParam();
+  const uint32_t num_bits = code.data_bits + code.check_bits;
+  std::vector<uint8_t> words = RandomWords(4);
+  for (int i = 0; i < 4; ++i) {
+    uint8_t *bytes = &words[(size_t)i * code.Bytes()];
+    uint8_t ecc = code.enc(bytes);
+
+    // Bits 0 to data_bits - 1 are data bits, the others check bits
+    for (uint32_t bit0 = 0; bit0 < num_bits; ++bit0) {
+      for (uint32_t bit1 = bit0 + 1; bit1 < num_bits; ++bit1) {
+        std::vector<uint8_t> corrupted(bytes, bytes + code.Bytes());
+        uint8_t corrupted_ecc = ecc;
+        for (uint32_t bit : {bit0, bit1}) {
+          if (bit < code.data_bits) {
+            FlipBit(corrupted.data(), bit);
+          } else {
+            corrupted_ecc ^= 1 << (bit - code.data_bits);
+          }
+        }
+
+        // A double error is flagged and not "corrected"
+        std::vector<uint8_t> decoded(corrupted);
+        EXPECT_EQ(code.dec(decoded.data(), corrupted_ecc), 2)
+            << "bits " << bit0 << " and " << bit1;
+        EXPECT_EQ(decoded, corrupted) << "bits " << bit0 << " and " << bit1;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllCodes, SecdedEncTest, testing::ValuesIn(kCodes));
+
+}  // namespace
+}  // namespace secded_enc_unittest
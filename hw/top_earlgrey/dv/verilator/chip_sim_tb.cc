@@ -2,11 +2,10 @@
 // Licensed under the Apache License, Version 2.0, see LICENSE for details.
 // SPDX-License-Identifier: Apache-2.0
 
-#include <algorithm>
 #include <iostream>
 #include <string>
-#include <vector>
 
+#include "mem_backdoor_server.h"
 #include "verilated_toplevel.h"
 #include "verilator_memutil.h"
 #include "verilator_sim_ctrl.h"
@@ -36,10 +35,8 @@ int main(int argc, char **argv) {
                      "gen_prim_flash_banks[1].u_prim_flash_bank.u_mem",
                  0x80000 / 8, 8);
   // Start with the flash region erased. Future loads can overwrite.
-  std::vector<uint8_t> all_ones(flash0.GetSizeBytes());
-  std::fill(all_ones.begin(), all_ones.end(), 0xffu);
-  flash0.Write(/*word_offset=*/0, all_ones);
-  flash1.Write(/*word_offset=*/0, all_ones);
+  flash0.Fill(/*word_offset=*/0, flash0.GetSizeWords(), 0xffu);
+  flash1.Fill(/*word_offset=*/0, flash1.GetSizeWords(), 0xffu);
 
   MemArea otp(top_scope + ".u_otp_macro." + ram1p_adv_scope, 0x4000 / 4, 4);
 
@@ -50,6 +47,9 @@ int main(int argc, char **argv) {
   memutil.RegisterMemoryArea("otp", 0x40000000u /* (bogus LMA) */, &otp);
   simctrl.RegisterExtension(&memutil);
 
+  MemBackdoorServer mem_backdoor(memutil.GetUnderlying());
+  simctrl.RegisterExtension(&mem_backdoor);
+
   // The initial reset delay must be long enough such that pwr/rst/clkmgr will
   // release clocks to the entire design.  This allows for synchronous resets
   // to appropriately propagate.
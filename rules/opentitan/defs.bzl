@@ -57,6 +57,7 @@ load(
 load(
     "@lowrisc_opentitan//rules/opentitan:sim_verilator.bzl",
     _sim_verilator = "sim_verilator",
+    _verilator_benchmark_params = "verilator_benchmark_params",
     _verilator_params = "verilator_params",
 )
 load(
@@ -97,6 +98,7 @@ silicon_params = _silicon_params
 
 sim_verilator = _sim_verilator
 verilator_params = _verilator_params
+verilator_benchmark_params = _verilator_benchmark_params
 
 sim_dv = _sim_dv
 dv_params = _dv_params
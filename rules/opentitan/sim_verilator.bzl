@@ -214,3 +214,27 @@ def verilator_params(
         param = kwargs,
         defines = defines,
     )
+
+def verilator_benchmark_params(tags = [], **kwargs):
+    """A macro to create verilator parameters for simulator benchmarks.
+
+    The test runs like any other verilator test, but the simulator writes its
+    statistics (cycles, wall time, cycles/s and peak RSS) as JSON to
+    `sim_stats.json` in the undeclared outputs of the test, i.e. to
+    `bazel-testlogs/<package>/<test>/test.outputs/outputs.zip`.
+
+    Args:
+      tags: Additional test tags; the test is always tagged `benchmark`.
+      kwargs: Additional arguments passed to `verilator_params`.
+    Returns:
+      struct of test parameters.
+    """
+    return verilator_params(
+        tags = ["benchmark"] + tags,
+        test_cmd = """
+            --verilator-args=--stats-file=${{TEST_UNDECLARED_OUTPUTS_DIR}}/sim_stats.json
+            --exec="console --non-interactive --exit-success='{exit_success}' --exit-failure='{exit_failure}'"
+            no-op
+        """,
+        **kwargs
+    )
@@ -41,21 +41,23 @@ C_SRC_TOP = """
 #include "secded_enc.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 // Calculates even parity for a 64-bit word
-static uint8_t calc_parity(uint64_t word, bool invert) {
-  bool parity = false;
-
-  while (word) {
-    if (word & 1) {
-      parity = !parity;
-    }
-
-    word >>= 1;
-  }
-
-  return parity ^ invert;
+static inline uint8_t calc_parity(uint64_t word, bool invert) {
+#if defined(__GNUC__)
+  return __builtin_parityll(word) ^ invert;
+#else
+  word ^= word >> 32;
+  word ^= word >> 16;
+  word ^= word >> 8;
+  word ^= word >> 4;
+  word ^= word >> 2;
+  word ^= word >> 1;
+
+  return (word & 1) ^ invert;
+#endif
 }
 """
 
@@ -63,6 +65,7 @@ C_H_TOP = """
 #ifndef OPENTITAN_HW_IP_PRIM_DV_PRIM_SECDED_SECDED_ENC_H_
 #define OPENTITAN_HW_IP_PRIM_DV_PRIM_SECDED_SECDED_ENC_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -72,11 +75,19 @@ extern "C" {
 // Integrity encode functions for varying bit widths matching the functionality
 // of the RTL modules of the same name. Each takes an array of bytes in
 // little-endian order and returns the calculated integrity bits.
+//
+// The enc_*_buf functions encode num_words words, stored one after the other
+// in the same format, and write the integrity bits of each word to ecc.
+//
+// The dec_* functions match the RTL decoders. Each takes an array of bytes in
+// little-endian order and the integrity bits stored with them. A single bit
+// error in the data is corrected in place. They return the error flags of the
+// RTL decoder: bit 0 is set for a single bit error and bit 1 for a double bit
+// error.
 
 """
 
-C_H_FOOT = """
-#ifdef __cplusplus
+C_H_FOOT = """#ifdef __cplusplus
 }  // extern "C"
 #endif  // __cplusplus
 
@@ -877,9 +888,17 @@ def write_c_files(n, k, m, codes, suffix, c_src_filename, c_h_filename,
     assert codetype in ["hsiao", "inv_hsiao"]
     invert = (codetype == "inv_hsiao")
 
+    # The generated code is formatted with clang-format by format_c_files()
+    name = f"secded{suffix}_{n}_{k}"
+    enc_buf_decl = (f"void enc_{name}_buf(const uint8_t *bytes, "
+                    f"{out_type} *ecc, size_t num_words)")
+    dec_decl = f"uint8_t dec_{name}(uint8_t bytes[{in_bytes}], {out_type} ecc)"
+    # The syndrome of a single bit error in each data bit
+    syndromes = ", ".join(f"0x{calc_syndrome(code):x}" for code in codes)
+
     with open(c_src_filename, "a") as f:
         # Write out function prototype in src
-        f.write(f"\n{out_type} enc_secded{suffix}_{n}_{k}"
+        f.write(f"\n{out_type} enc_{name}"
                 f"(const uint8_t bytes[{in_bytes}]) {{\n")
 
         # Form a single word from the incoming byte data
@@ -900,10 +919,45 @@ def write_c_files(n, k, m, codes, suffix, c_src_filename, c_h_filename,
 
         f.write(";\n}\n")
 
+        # The buffer version just calls the encode function, which the
+        # compiler inlines.
+        f.write(f"""
+{enc_buf_decl} {{
+  for (size_t i = 0; i < num_words; ++i) {{
+    ecc[i] = enc_{name}(&bytes[{in_bytes} * i]);
+  }}
+}}
+""")
+
+        # The syndrome is the difference between the stored integrity bits and
+        # those of the data (with the same inversion). Hsiao codes have odd
+        # weight columns, so a syndrome with even weight is a double error.
+        f.write(f"""
+{dec_decl} {{
+  static const {out_type} kDataSyndromes[{k}] = {{{syndromes}}};
+
+  {out_type} syndrome = enc_{name}(bytes) ^ ecc;
+  if (!calc_parity(syndrome, false)) {{
+    return syndrome ? 2 : 0;
+  }}
+
+  // A single bit error, which needs correcting if it is in the data bits
+  for (int i = 0; i < {k}; ++i) {{
+    if (syndrome == kDataSyndromes[i]) {{
+      bytes[i / 8] ^= 1 << (i % 8);
+      break;
+    }}
+  }}
+  return 1;
+}}
+""")
+
     with open(c_h_filename, "a") as f:
-        # Write out function declaration in header
-        f.write(f"{out_type} enc_secded{suffix}_{n}_{k}"
+        # Write out function declarations in header
+        f.write(f"{out_type} enc_{name}"
                 f"(const uint8_t bytes[{in_bytes}]);\n")
+        f.write(f"{enc_buf_decl};\n")
+        f.write(f"{dec_decl};\n\n")
 
 
 def format_c_files(c_src_filename, c_h_filename):